@@ -93,17 +93,12 @@ namespace fc {
   template<typename T, size_t N>
   void to_variant( const array<T,N>& bi, variant& v )
   {
-     v = std::vector<char>( (const char*)&bi, ((const char*)&bi) + sizeof(bi) );
+     v = blob{ std::vector<char>( (const char*)&bi, ((const char*)&bi) + sizeof(bi) ) };
   }
   template<typename T, size_t N>
   void from_variant( const variant& v, array<T,N>& bi )
   {
-    std::vector<char> ve = v.as< std::vector<char> >();
-    if( ve.size() )
-    {
-        memcpy(&bi, ve.data(), fc::min<size_t>(ve.size(),sizeof(bi)) );
-    }
-    else
+    if( !from_variant( v, (char*)&bi, sizeof(bi) ) )
         memset( &bi, char(0), sizeof(bi) );
   }
 
@@ -0,0 +1,94 @@
+#pragma once
+#include <fc/io/iostream.hpp>
+#include <vector>
+#include <memory>
+
+namespace fc {
+
+  /**
+   *  @defgroup lz4 lz4
+   *
+   *  Compression in the LZ4 block format, which trades ratio for speed: it is
+   *  meant for messages on the wire and hot storage rather than archives,
+   *  see lzma_compress for those.  The codec is liblz4, these functions only
+   *  adapt it to fc's sizes and exceptions.  Blocks are limited to
+   *  LZ4_MAX_INPUT_SIZE, about 2 GB.
+   */
+  ///@{
+
+  /** @return the largest size that @param size bytes can compress to */
+  size_t lz4_compress_bound( size_t size );
+
+  /**
+   *  @param out must have room for lz4_compress_bound( size ) bytes
+   *  @return the number of bytes written to out
+   */
+  size_t lz4_compress( const char* in, size_t size, char* out );
+
+  /**
+   *  @throws if @param in is corrupt or decompresses to more than @param out_size bytes
+   *  @return the number of bytes written to out
+   */
+  size_t lz4_decompress( const char* in, size_t size, char* out, size_t out_size );
+
+  /** compresses @param in with its size in front, 4 bytes little endian */
+  std::vector<char> lz4_compress( const std::vector<char>& in );
+  /** @throws if @param compressed is corrupt or claims to be larger than @param max_size */
+  std::vector<char> lz4_decompress( const std::vector<char>& compressed, size_t max_size = 64*1024*1024 );
+
+  ///@}
+
+  /**
+   *  Compresses everything written to it into @param sink in blocks.
+   *
+   *  Every block is written as its stored and uncompressed size, 4 bytes each
+   *  little endian, followed by the block.  A block that does not compress is
+   *  stored as is, with both sizes equal.  close() ends the stream with a
+   *  block of size 0 and flush() writes the data written so far as a block
+   *  of its own.
+   */
+  class lz4_ostream : public ostream
+  {
+     public:
+        lz4_ostream( ostream_ptr sink, size_t block_size = 64*1024 );
+        ~lz4_ostream();
+
+        virtual size_t writesome( const char* buf, size_t len );
+        virtual void   close();
+        virtual void   flush();
+
+     private:
+        void write_block();
+
+        ostream_ptr       _sink;
+        size_t            _block_size;
+        std::vector<char> _block;
+        std::vector<char> _compressed;
+        bool              _closed;
+  };
+
+  /**
+   *  Decompresses the stream written by an lz4_ostream as it is read.
+   */
+  class lz4_istream : public istream
+  {
+     public:
+        /** @param max_block_size blocks that claim to be larger are rejected as corrupt */
+        lz4_istream( istream_ptr source, size_t max_block_size = 4*1024*1024 );
+        ~lz4_istream();
+
+        virtual size_t readsome( char* buf, size_t len );
+
+     private:
+        /** @return false after the block that ends the stream */
+        bool next_block();
+
+        istream_ptr       _source;
+        size_t            _max_block_size;
+        std::vector<char> _compressed;
+        std::vector<char> _plain;
+        size_t            _pos;
+        bool              _done;
+  };
+
+} // namespace fc
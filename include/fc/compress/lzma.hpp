@@ -1,9 +1,74 @@
 #pragma once
+#include <fc/io/iostream.hpp>
 #include <vector>
+#include <memory>
 
 namespace fc {
+  class path;
 
-  std::vector<char> lzma_compress( const std::vector<char>& in );
+  /** compresses @param in into a single lzip member, see lzma_compress_file */
+  std::vector<char> lzma_compress( const std::vector<char>& in, unsigned char level = 5 );
+  /** @throws if @param compressed is not a valid lzip member */
   std::vector<char> lzma_decompress( const std::vector<char>& compressed );
 
+  /**
+   *  Compresses the file @param src into @param dst in the lzip format without
+   *  reading the whole file into memory.
+   *
+   *  @param level 1 (fastest) to 9 (smallest)
+   */
+  void lzma_compress_file( const path& src, const path& dst, unsigned char level = 5 );
+
+  namespace detail
+  {
+     class lzma_ostream_impl;
+     class lzma_istream_impl;
+  }
+
+  /**
+   *  Compresses everything written to it into @param sink in independent
+   *  blocks, so that memory use is bounded by the block size and large
+   *  inputs are compressed by several threads at once.
+   *
+   *  Every block is written as its compressed and uncompressed size, 4 bytes
+   *  each little endian, followed by the block as an lzip member.  close()
+   *  ends the stream with a block of size 0.  flush() compresses the data
+   *  written so far as a block of its own.
+   */
+  class lzma_ostream : public ostream
+  {
+     public:
+        /**
+         *  @param block_size the uncompressed size of the blocks
+         *  @param threads the maximum number of blocks compressed at once, 0 uses one per core
+         */
+        lzma_ostream( ostream_ptr sink, unsigned char level = 5,
+                      size_t block_size = 4*1024*1024, uint32_t threads = 0 );
+        ~lzma_ostream();
+
+        virtual size_t writesome( const char* buf, size_t len );
+        virtual void   close();
+        virtual void   flush();
+
+     private:
+        std::unique_ptr<detail::lzma_ostream_impl> my;
+  };
+
+  /**
+   *  Decompresses the stream written by an lzma_ostream as it is read, one
+   *  block at a time.
+   */
+  class lzma_istream : public istream
+  {
+     public:
+        /** @param max_block_size blocks that claim to be larger are rejected as corrupt */
+        lzma_istream( istream_ptr source, size_t max_block_size = 64*1024*1024 );
+        ~lzma_istream();
+
+        virtual size_t readsome( char* buf, size_t len );
+
+     private:
+        std::unique_ptr<detail::lzma_istream_impl> my;
+  };
+
 } // namespace fc
@@ -1,5 +1,8 @@
 #pragma once
 #include <fc/crypto/sha512.hpp>
+#include <fc/crypto/sha256.hpp>
+#include <fc/io/iostream.hpp>
+#include <fc/array.hpp>
 #include <vector>
 
 namespace fc {
@@ -7,4 +10,161 @@ namespace fc {
 std::vector<char> aes_encrypt( const fc::sha512& key, const std::vector<char>& plain_text  );
 std::vector<char> aes_decrypt( const fc::sha512& key, const std::vector<char>& cipher_text );
 
-} 
+struct aes_mode
+{
+   enum type
+   {
+      /** AES-256-CBC with PKCS#7 padding, 16 byte iv */
+      cbc = 0,
+      /** AES-256-GCM authenticated encryption, 12 byte iv and 16 byte tag */
+      gcm = 1
+   };
+};
+
+/** the authentication tag of aes_mode::gcm */
+typedef fc::array<char,16> aes_tag;
+
+namespace detail { class aes_cipher_impl; }
+
+/**
+ *  Encrypts a message in any number of pieces through a cipher context that
+ *  is kept between messages.  Call init() once per key and reset() with a
+ *  new iv before each further message.
+ */
+class aes_encoder
+{
+   public:
+      aes_encoder();
+      ~aes_encoder();
+
+      void init( const fc::sha256& key, const char* iv, aes_mode::type mode = aes_mode::cbc );
+      /** starts a new message with the key and mode of the last init() */
+      void reset( const char* iv );
+
+      /** adds data that is authenticated but not encrypted, gcm only, before any encode() */
+      void authenticate( const char* data, size_t len );
+
+      /**
+       *  @param cipher_text must have room for len + 16 bytes
+       *  @return the number of bytes written to cipher_text
+       */
+      size_t encode( const char* plain_text, size_t len, char* cipher_text );
+      /**
+       *  Ends the message.
+       *  @param cipher_text must have room for 16 bytes of cbc padding
+       *  @return the number of bytes written to cipher_text
+       */
+      size_t final_encode( char* cipher_text );
+
+      /** the tag of the last gcm message, valid after final_encode() */
+      aes_tag tag()const;
+
+   private:
+      std::unique_ptr<detail::aes_cipher_impl> my;
+};
+
+/**
+ *  Decrypts a message produced by aes_encoder, see aes_encoder.
+ */
+class aes_decoder
+{
+   public:
+      aes_decoder();
+      ~aes_decoder();
+
+      void init( const fc::sha256& key, const char* iv, aes_mode::type mode = aes_mode::cbc );
+      void reset( const char* iv );
+
+      void authenticate( const char* data, size_t len );
+
+      /**
+       *  @param plain_text must have room for len + 16 bytes
+       *  @return the number of bytes written to plain_text
+       */
+      size_t decode( const char* cipher_text, size_t len, char* plain_text );
+
+      /** the tag the gcm message is checked against, set before final_decode() */
+      void set_tag( const aes_tag& t );
+
+      /**
+       *  Ends the message.
+       *  @throws if the padding is invalid or the gcm tag does not match
+       *  @return the number of bytes written to plain_text, at most 16
+       */
+      size_t final_decode( char* plain_text );
+
+   private:
+      std::unique_ptr<detail::aes_cipher_impl> my;
+};
+
+/**
+ *  Encrypts everything written to it into @param sink.  close() ends the
+ *  message.
+ *
+ *  In gcm mode the plain text is sealed in records of 64KB, each followed by
+ *  its own tag.  Record n uses the iv with n xored into its last 8 bytes and
+ *  authenticates whether it is the last record, so records cannot be
+ *  reordered, dropped or truncated without failing authentication.  Data is
+ *  written to @param sink a whole record at a time, flush() does not seal
+ *  a partial record.
+ */
+class aes_ostream : public ostream
+{
+   public:
+      aes_ostream( ostream_ptr sink, const fc::sha256& key, const char* iv, aes_mode::type mode = aes_mode::cbc );
+      ~aes_ostream();
+
+      virtual size_t writesome( const char* buf, size_t len );
+      virtual void   close();
+      virtual void   flush();
+
+   private:
+      /** encrypts _plain as the next gcm record and writes it with its tag */
+      void seal( bool last );
+
+      ostream_ptr       _sink;
+      aes_encoder       _encoder;
+      aes_mode::type    _mode;
+      std::vector<char> _buffer;
+      /** the plain text of the gcm record being filled */
+      std::vector<char> _plain;
+      char              _iv[12];
+      uint64_t          _records;
+      bool              _closed;
+};
+
+/**
+ *  Decrypts the stream written by an aes_ostream as it is read.  The end
+ *  of @param source ends the message.
+ *
+ *  In gcm mode each record is verified before any of it is returned, a
+ *  record that fails authentication throws and nothing after it is read.
+ *  cbc mode is not authenticated at all.
+ */
+class aes_istream : public istream
+{
+   public:
+      aes_istream( istream_ptr source, const fc::sha256& key, const char* iv, aes_mode::type mode = aes_mode::cbc );
+      ~aes_istream();
+
+      virtual size_t readsome( char* buf, size_t len );
+
+   private:
+      void finish();
+      /** verifies and decrypts the first @param len bytes of _held as the next gcm record */
+      void open_record( size_t len, bool last );
+
+      istream_ptr       _source;
+      aes_decoder       _decoder;
+      aes_mode::type    _mode;
+      std::vector<char> _cipher;
+      /** gcm cipher text read but not yet known to be a complete record */
+      std::vector<char> _held;
+      std::vector<char> _plain;
+      size_t            _plain_pos;
+      char              _iv[12];
+      uint64_t          _records;
+      bool              _done;
+};
+
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+namespace fc {
+
+  /**
+   *  CRC-32C (Castagnoli) of @param len bytes at @param data.  To checksum
+   *  data in pieces pass the result for the previous pieces as @param crc.
+   *
+   *  Uses the SSE4.2 crc32 instruction when the cpu has it, whatever flags
+   *  the library was compiled with.
+   */
+  uint32_t crc32c( const char* data, size_t len, uint32_t crc = 0 );
+
+  namespace detail
+  {
+     /** @return true if the cpu supports the SSE4.2 crc32 instruction */
+     bool crc32c_hardware();
+  }
+
+} // namespace fc
@@ -5,6 +5,7 @@
 #include <fc/fwd.hpp>
 #include <fc/array.hpp>
 #include <fc/io/raw_fwd.hpp>
+#include <vector>
 
 namespace fc { 
 
@@ -22,6 +23,13 @@ namespace fc {
     /**
      *  @class public_key
      *  @brief contains only the public point of an elliptic curve key.
+     *
+     *  The key is kept in its 33 byte compressed form, comparing, hashing and
+     *  serializing never touch the curve.  The point is decoded at most once
+     *  and cached from then on.  Keys built from serialized bytes decode it
+     *  right away and throw if the bytes are not a point on the curve; keys
+     *  produced by fc, such as private_key::get_public_key(), defer it until
+     *  an operation such as verify() or valid() needs it.
      */
     class public_key
     {
@@ -29,8 +37,8 @@ namespace fc {
            public_key();
            public_key(const public_key& k);
            ~public_key();
-           bool verify( const fc::sha256& digest, const signature& sig );
-           public_key_data serialize()const;
+           bool verify( const fc::sha256& digest, const signature& sig )const;
+           public_key_data serialize()const { return _data; }
 
            operator public_key_data()const { return serialize(); }
 
@@ -47,10 +55,20 @@ namespace fc {
 
            inline friend bool operator==( const public_key& a, const public_key& b )
            {
-            return a.serialize() == b.serialize();
+            return a._data == b._data;
+           }
+           inline friend bool operator!=( const public_key& a, const public_key& b )
+           {
+            return a._data != b._data;
+           }
+           inline friend bool operator<( const public_key& a, const public_key& b )
+           {
+            return a._data < b._data;
            }
         private:
           friend class private_key;
+          friend class detail::public_key_impl;
+          public_key_data                    _data;
           fc::fwd<detail::public_key_impl,8> my;
     };
 
@@ -95,6 +113,26 @@ namespace fc {
         private:
            fc::fwd<detail::private_key_impl,8> my;
     };
+
+    /**
+     *  Verifies @param count signatures at once, result[i] is true if sigs[i] is a
+     *  valid signature of digests[i] by keys[i].
+     *
+     *  Large batches are split over a shared pool of threads.
+     *  @param threads the maximum number of threads to use, 0 uses one per core
+     */
+    std::vector<bool> verify_batch( const fc::sha256* digests, const signature* sigs, const public_key* keys,
+                                    size_t count, uint32_t threads = 0 );
+
+    /**
+     *  Recovers the keys of @param count compact signatures at once, result[i] is
+     *  the key that signed digests[i] with sigs[i], or an invalid key if recovery
+     *  failed.
+     *
+     *  @param threads the maximum number of threads to use, 0 uses one per core
+     */
+    std::vector<public_key> recover_batch( const fc::sha256* digests, const compact_signature* sigs,
+                                           size_t count, uint32_t threads = 0 );
   } // namespace ecc
   void to_variant( const ecc::private_key& var,  variant& vo );
   void from_variant( const variant& var,  ecc::private_key& vo );
@@ -134,3 +172,17 @@ namespace fc {
   } // namespace raw
 
 } // namespace fc 
+
+namespace std
+{
+    template<typename T> struct hash;
+
+    template<>
+    struct hash<fc::ecc::public_key>
+    {
+       size_t operator()( const fc::ecc::public_key& k )const
+       {
+          return std::hash<fc::ecc::public_key_data>()( k.serialize() );
+       }
+    };
+}
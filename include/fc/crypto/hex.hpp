@@ -6,8 +6,18 @@ namespace fc {
     uint8_t from_hex( char c );
     fc::string to_hex( const char* d, uint32_t s );
 
+    /** writes the 2*s lower case hex digits of @param d to @param out */
+    void to_hex( const char* d, size_t s, char* out );
+
     /**
      *  @return the number of bytes decoded
      */
     size_t from_hex( const fc::string& hex_str, char* out_data, size_t out_data_len );
+
+    /**
+     *  Decodes the @param hex_len digits at @param hex, an odd last digit
+     *  fills the high half of the last byte.
+     *  @return the number of bytes decoded
+     */
+    size_t from_hex( const char* hex, size_t hex_len, char* out_data, size_t out_data_len );
 } 
@@ -0,0 +1,78 @@
+#pragma once
+#include <fc/crypto/sha256.hpp>
+#include <vector>
+
+namespace fc
+{
+  /**
+   *  Merkle trees over sha256 leaves.
+   *
+   *  An interior node is sha256( left || right ).  A level with an odd number
+   *  of nodes pairs its last node with itself.  The root of an empty tree is
+   *  sha256() and the root of a single leaf is the leaf itself.
+   */
+  namespace merkle
+  {
+    /** the parent of two nodes */
+    sha256 hash_pair( const sha256& left, const sha256& right );
+
+    /**
+     *  Computes the root of @param count leaves.  Every level is hashed with
+     *  sha256::hash_many and large levels are split over a pool of threads.
+     *
+     *  @param threads the maximum number of threads to use, 0 uses one per core
+     */
+    sha256 root( const sha256* leaves, size_t count, uint32_t threads = 0 );
+    inline sha256 root( const std::vector<sha256>& leaves, uint32_t threads = 0 )
+    {
+      return root( leaves.data(), leaves.size(), threads );
+    }
+
+    /**
+     *  The siblings on the path from a leaf to the root, which proves that the
+     *  leaf is included in a tree without the other leaves.
+     */
+    struct proof
+    {
+      proof():index(0){}
+
+      /** position of the leaf in the tree */
+      uint64_t             index;
+      /** sibling at every level, starting next to the leaf */
+      std::vector<sha256>  path;
+
+      /** @return the root of the tree if @param leaf is at index */
+      sha256 compute_root( const sha256& leaf )const;
+      bool   verify( const sha256& leaf, const sha256& root )const { return compute_root( leaf ) == root; }
+    };
+
+    /** @return the proof of the leaf at @param index of @param count leaves */
+    proof make_proof( const sha256* leaves, size_t count, uint64_t index );
+
+    /**
+     *  A tree that keeps all of its levels so that leaves can be appended and
+     *  the root and proofs read back in O(log n) rather than rehashing.
+     */
+    class tree
+    {
+      public:
+        tree(){}
+        explicit tree( const std::vector<sha256>& leaves, uint32_t threads = 0 );
+
+        void   append( const sha256& leaf );
+        size_t size()const { return _levels.size() ? _levels[0].size() : 0; }
+        sha256 root()const;
+        proof  make_proof( uint64_t index )const;
+
+        const std::vector<sha256>& leaves()const;
+
+      private:
+        /** _levels[0] are the leaves, _levels.back() holds the root */
+        std::vector< std::vector<sha256> > _levels;
+    };
+
+  } // namespace merkle
+} // namespace fc
+
+#include <fc/reflect/reflect.hpp>
+FC_REFLECT( fc::merkle::proof, (index)(path) )
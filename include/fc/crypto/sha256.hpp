@@ -19,6 +19,15 @@ class sha256
     static sha256 hash( const char* d, uint32_t dlen );
     static sha256 hash( const string& );
 
+    /**
+     *  Hashes @param count independent messages, out[i] is the hash of the
+     *  sizes[i] bytes at data[i].
+     *
+     *  Many short messages are hashed several at a time with AVX2 / AVX-512
+     *  or one at a time with the SHA extensions, whichever the cpu supports.
+     */
+    static void hash_many( const char* const* data, const uint32_t* sizes, sha256* out, size_t count );
+
     template<typename T>
     static sha256 hash( const T& t ) 
     { 
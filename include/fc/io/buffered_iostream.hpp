@@ -12,11 +12,14 @@ namespace fc
    /**
     *  @brief Reads data from an unbuffered stream
     *         and enables peek functionality.
+    *
+    *  Data is read from the stream straight into a ring buffer of bufsize
+    *  bytes, which parsers can also read in place with data() and consume().
     */
    class buffered_istream : public virtual istream
    {
       public:
-        buffered_istream( istream_ptr is );
+        buffered_istream( istream_ptr is, size_t bufsize = 4096 );
         buffered_istream( buffered_istream&& o );
 
         buffered_istream& operator=( buffered_istream&& i );
@@ -39,6 +42,21 @@ namespace fc
          */
         char               peek()const;
 
+        /** reads one character, hides istream::get() which goes through readsome() */
+        char               get();
+
+        /**
+         *  The buffered bytes that are contiguous in memory, this method may
+         *  block until at least 1 character is available.  The bytes stay valid
+         *  until the next call to a non-const method.
+         *
+         *  @param len set to the number of bytes at the returned pointer
+         */
+        const char*        data( size_t& len );
+
+        /** removes @param len bytes returned by data() from the buffer */
+        void               consume( size_t len );
+
       private:
         std::unique_ptr<detail::buffered_istream_impl> my;
    };
@@ -46,7 +64,9 @@ namespace fc
 
 
    /**
-    * 
+    *  Collects writes in a ring buffer of bufsize bytes and writes them
+    *  to the stream when it is full or flushed.  Writes larger than the buffer
+    *  go straight to the stream.
     */
    class buffered_ostream : public virtual ostream
    {
@@ -64,6 +84,17 @@ namespace fc
 
         virtual void close();
         virtual void flush();
+
+        /**
+         *  Free space in the buffer to serialize into without a copy, this method
+         *  may block to write out the buffer if it is full.
+         *
+         *  @param len set to the number of bytes at the returned pointer, at least 1
+         */
+        char*           prepare( size_t& len );
+
+        /** adds @param len bytes written at the pointer returned by prepare() */
+        void            commit( size_t len );
       private:
         std::unique_ptr<detail::buffered_ostream_impl> my;
    };
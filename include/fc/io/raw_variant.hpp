@@ -39,6 +39,10 @@ namespace fc { namespace raw {
          {
             fc::raw::pack( s, v );
          }
+         virtual void handle( const blob& v)const
+         {
+            fc::raw::pack( s, v.data );
+         }
         
          Stream& s;
         
@@ -109,6 +113,13 @@ namespace fc { namespace raw {
             v = fc::move(val);
             return;
          }
+         case variant::blob_type:
+         {
+            blob val;
+            raw::unpack(s,val.data);
+            v = fc::move(val);
+            return;
+         }
          default:
             FC_THROW_EXCEPTION( parse_error_exception, "Unknown Variant Type ${t}", ("t", t) );
       }
@@ -39,5 +39,12 @@ namespace fc {
          static bool          register_appender( const fc::string& type, const appender_factory::ptr& f );
 
          virtual void log( const log_message& m ) = 0;
+
+         /**
+          *  Logs count messages at once, appenders that can combine the
+          *  output of several messages into a single write should override
+          *  this.
+          */
+         virtual void log_batch( const log_message* msgs, size_t count );
    };
 }
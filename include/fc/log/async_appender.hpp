@@ -0,0 +1,52 @@
+#pragma once
+#include <fc/log/appender.hpp>
+#include <fc/log/logger.hpp>
+#include <vector>
+
+namespace fc
+{
+   /**
+    *  Forwards messages to other appenders from a dedicated writer thread.
+    *
+    *  Each thread that logs gets its own bounded, lock-free queue so that
+    *  producers never contend with each other.  The writer thread drains
+    *  every queue and hands the messages to the target appenders in batches,
+    *  so formatting and file writes happen off the logging thread and are
+    *  combined into a few large writes.
+    *
+    *  The target appenders must be configured before the async appender
+    *  that refers to them.
+    */
+   class async_appender : public appender
+   {
+       public:
+            /** what to do when a thread's queue is full */
+            struct overflow_policy { enum type { drop, block }; };
+
+            struct config
+            {
+               config()
+               :queue_size(4096),overflow(overflow_policy::block),max_batch(1024){}
+
+               /// names of the appenders messages are forwarded to
+               std::vector<fc::string>            appenders;
+               /// maximum number of pending messages per logging thread
+               uint32_t                           queue_size;
+               async_appender::overflow_policy::type overflow;
+               /// maximum number of messages handed to the targets at once
+               uint32_t                           max_batch;
+            };
+
+            async_appender( const variant& args );
+            ~async_appender();
+            virtual void log( const log_message& m );
+
+       private:
+            class impl;
+            fc::shared_ptr<impl> my;
+   };
+} // namespace fc
+
+#include <fc/reflect/reflect.hpp>
+FC_REFLECT_ENUM( fc::async_appender::overflow_policy::type, (drop)(block) )
+FC_REFLECT( fc::async_appender::config, (appenders)(queue_size)(overflow)(max_batch) )
@@ -0,0 +1,51 @@
+#pragma once
+#include <fc/log/appender.hpp>
+#include <fc/log/logger.hpp>
+#include <fc/filesystem.hpp>
+#include <vector>
+
+namespace fc {
+
+   /**
+    *  Writes log messages as binary records instead of text.
+    *
+    *  Records go to segment_count memory mapped files named filename.0,
+    *  filename.1, ... of segment_size bytes each.  When a segment is full the
+    *  appender moves on to the next one, overwriting the oldest, so the log
+    *  never grows beyond segment_count * segment_size bytes.
+    *
+    *  Each message is stored as a call-site id, timestamp, thread name and
+    *  the raw packed arguments.  The file, line, method and format of a call
+    *  site are written once per segment, the first time the site is used.
+    *  Messages are never formatted by the appender, use read_binary_log() or
+    *  the fc_log_decode tool to turn a log back into text.
+    */
+   class binary_appender : public appender {
+      public:
+         struct config {
+            config( const fc::path& p = "log.bin" );
+
+            fc::path                           filename;
+            uint64_t                           segment_size;
+            uint32_t                           segment_count;
+         };
+         binary_appender( const variant& args );
+         ~binary_appender();
+         virtual void log( const log_message& m );
+         virtual void log_batch( const log_message* msgs, size_t count );
+
+      private:
+         class impl;
+         fc::shared_ptr<impl> my;
+   };
+
+   /**
+    *  Decodes every segment written by a binary_appender configured with
+    *  @param filename, oldest message first.
+    */
+   std::vector<log_message> read_binary_log( const fc::path& filename );
+
+} // namespace fc
+
+#include <fc/reflect/reflect.hpp>
+FC_REFLECT( fc::binary_appender::config, (filename)(segment_size)(segment_count) )
@@ -50,6 +50,7 @@ namespace fc
             console_appender( const variant& args );
             const char* get_color( log_level l )const;
             virtual void log( const log_message& m );
+            virtual void log_batch( const log_message* msgs, size_t count );
 
        private:
             config                      cfg;
@@ -16,10 +16,20 @@ class file_appender : public appender {
             fc::path                           filename;
             bool                               flush;
             bool                               truncate;
+            /// rotated files are named filename.YYYYMMDDTHHMMSS-NNNN, in UTC with a sequence number
+            /// rotate once the file reaches this many bytes, 0 disables size based rotation
+            uint64_t                           rotate_size;
+            /// rotate after this many seconds, 0 disables time based rotation
+            uint32_t                           rotate_interval;
+            /// compress rotated files with lzma and give them a .lz extension
+            bool                               compress;
+            /// number of rotated files to keep, 0 keeps all of them
+            uint32_t                           max_files;
          };
          file_appender( const variant& args );
          ~file_appender();
          virtual void log( const log_message& m );
+         virtual void log_batch( const log_message* msgs, size_t count );
 
       private:
          class impl;
@@ -28,4 +38,4 @@ class file_appender : public appender {
 } // namespace fc
 
 #include <fc/reflect/reflect.hpp>
-FC_REFLECT( fc::file_appender::config, (format)(filename)(flush)(truncate) )
+FC_REFLECT( fc::file_appender::config, (format)(filename)(flush)(truncate)(rotate_size)(rotate_interval)(compress)(max_files) )
@@ -6,14 +6,21 @@
 #include <fc/time.hpp>
 #include <fc/variant_object.hpp>
 #include <fc/shared_ptr.hpp>
+#include <fc/log/log_scope.hpp>
+#include <algorithm>
 #include <memory>
+#include <vector>
 
 namespace fc
 {
+   class logger;
+
    namespace detail 
    { 
        class log_context_impl; 
        class log_message_impl; 
+       struct log_site_state;
+       struct log_context_link;
    }
 
    /**
@@ -46,6 +53,146 @@ namespace fc
    void to_variant( log_level e, variant& v );
    void from_variant( const variant& e, log_level& ll );
 
+   /**
+    *  @brief the ("key",value) arguments of a log statement.
+    *
+    *  Captures the arguments into one buffer instead of a mutable_variant_object:
+    *  keys, integers, doubles, bools and strings are copied in as their bytes,
+    *  and only other types are converted to a variant.  Nothing refers to the
+    *  caller's memory, so the arguments can be queued, and nothing is formatted
+    *  until an appender asks for the message.
+    */
+   class log_args
+   {
+      public:
+         enum arg_type { int_arg, uint_arg, double_arg, bool_arg, string_arg, variant_arg };
+
+         /** a single argument as stored, valid as long as the log_args */
+         struct arg
+         {
+            const char* key;
+            size_t      key_size;
+            arg_type    type;
+            const char* data;
+            size_t      size;
+
+            /** converts the value the same way mutable_variant_object would have */
+            variant     value( const log_args& args )const;
+            /** appends the value as format_string() would show it to @param out */
+            void        format( const log_args& args, string& out )const;
+         };
+
+         template<typename T, size_t N>
+         log_args& operator()( const char (&key)[N], const T& v )
+         {
+            // the array may be a buffer larger than the key it holds
+            add_key( key, std::find( key, key + N, '\0' ) - key );
+            add_value( v );
+            return *this;
+         }
+         template<typename T>
+         log_args& operator()( const fc::string& key, const T& v )
+         {
+            add_key( key );
+            add_value( v );
+            return *this;
+         }
+
+         bool           empty()const { return _data.empty(); }
+         /** reads the argument at @param pos and advances pos, @return false at the end */
+         bool           next( size_t& pos, arg& a )const;
+         /** @return the last argument named @param key, like mutable_variant_object::set keeps the last */
+         bool           find( const string& key, arg& a )const;
+         variant_object to_variant_object()const;
+
+      private:
+         void add_key( const char* key, size_t len );
+         void add_key( const fc::string& key ) { add_key( key.data(), key.size() ); }
+
+         void add_value( bool v );
+         void add_value( int v )                { add_int( v ); }
+         void add_value( long v )               { add_int( v ); }
+         void add_value( long long v )          { add_int( v ); }
+         void add_value( unsigned int v )       { add_uint( v ); }
+         void add_value( unsigned long v )      { add_uint( v ); }
+         void add_value( unsigned long long v ) { add_uint( v ); }
+         void add_value( double v );
+         void add_value( const char* v );
+         void add_value( const fc::string& v );
+         void add_value( const variant& v );
+         template<typename T>
+         void add_value( const T& v ) { add_value( variant( v ) ); }
+
+         void add_int( int64_t v );
+         void add_uint( uint64_t v );
+         void add_bytes( arg_type t, const void* p, size_t len );
+
+         std::vector<char>    _data;
+         /** arguments that are neither numbers nor strings */
+         std::vector<variant> _variants;
+   };
+
+   /**
+    *  @brief describes a single log statement.
+    *
+    *  The log macros create one static log_site per call site so that the file
+    *  name is trimmed and the format string is split into literal text and
+    *  ${key} placeholders once, rather than for every message.
+    */
+   class log_site
+   {
+      public:
+         /** pre-parses @param format, a string literal whose contents never change */
+         template<size_t N>
+         log_site( log_level ll, const char* file, uint64_t line, const char* method, const char (&format)[N] )
+         :log_site( ll, file, line, method, format, true ){}
+
+         /**
+          *  Formats that are not literals may be buffers whose contents change from one
+          *  message to the next, such sites never pre-parse and always take the slow path.
+          */
+         template<size_t N>
+         log_site( log_level ll, const char* file, uint64_t line, const char* method, char (&format)[N] )
+         :log_site( ll, file, line, method, format, false ){}
+         template<typename Char>
+         log_site( log_level ll, const char* file, uint64_t line, const char* method, Char* const& format )
+         :log_site( ll, file, line, method, format, false ){}
+         log_site( log_level ll, const char* file, uint64_t line, const char* method, const fc::string& format );
+
+         /** equivalent to format_string( format, args ) without rescanning the format */
+         string      format_message( const variant_object& args )const;
+         string      format_message( const log_args& args )const;
+
+         /**
+          *  Applies the rate limit and sampling configured for this site, see
+          *  logging_config::limits.  Cheap when the site is not limited.  A
+          *  dropped message is counted and reported to @param l by the site's
+          *  next message or by flush_suppressed_log_messages().
+          */
+         bool        should_log( const logger& l )const;
+         /** @return the number of messages dropped by should_log() since the last call */
+         uint64_t    take_suppressed()const;
+
+         log_level   level;
+         string      file;
+         uint64_t    line;
+         const char* method;
+         const char* format;
+
+      private:
+         log_site( log_level ll, const char* file, uint64_t line, const char* method, const char* format, bool is_literal );
+
+         struct segment
+         {
+            segment( string t, bool k ):text(std::move(t)),is_key(k){}
+            string text;
+            bool   is_key;
+         };
+         std::vector<segment> _segments;
+         /** owned by the site registry, which outlives the site */
+         detail::log_site_state* _state;
+   };
+
    /**
     *  @brief provides information about where and when a log message was generated.
     *  @ingroup AthenaSerializable
@@ -60,6 +207,8 @@ namespace fc
                     const char* file, 
                     uint64_t line, 
                     const char* method );
+        /** refers to @param site instead of copying the file and method names */
+        explicit log_context( const log_site& site );
         ~log_context();
         explicit log_context( const variant& v );
         variant to_variant()const;
@@ -71,13 +220,23 @@ namespace fc
         string        get_host_name()const;
         time_point    get_timestamp()const;
         log_level     get_log_level()const;
+        /** the names passed to append_context joined by "->", built when it is called */
         string        get_context()const;
+        /** the values of the log_scopes active when the message was created, outer scopes first */
+        variant_object get_scope()const;
 
+        /** adds @param c to this context only, copies made before keep their context */
         void          append_context( const fc::string& c );
+        /** @return a copy with @param c appended to the context, this context is not modified */
+        log_context   with_context( const fc::string& c )const;
 
         string        to_string()const;
       private:
-        std::shared_ptr<detail::log_context_impl> my;
+        friend class log_message;
+
+        std::shared_ptr<detail::log_context_impl>       my;
+        /** the appended names, newest first, shared with the copies they were appended to */
+        std::shared_ptr<const detail::log_context_link> _chain;
    };
 
    void to_variant( const log_context& l, variant& v );
@@ -109,6 +268,15 @@ namespace fc
           *  @param ctx - generally provided using the FC_LOG_CONTEXT(LEVEL) macro 
           */
          log_message( log_context ctx, const char* format, variant_object args = variant_object() );
+         /**
+          *  Formats lazily using the pre-parsed format of @param site.  Falls back to
+          *  the plain constructor if @param format is not the format of the site.
+          */
+         log_message( const log_site& site, const char* format, variant_object args );
+         log_message( const log_site& site, const fc::string& format, variant_object args );
+         /** keeps @param args as captured, get_data() converts them when it is called */
+         log_message( const log_site& site, const char* format, log_args args );
+         log_message( const log_site& site, const fc::string& format, log_args args );
          ~log_message();
 
          log_message( const variant& v );
@@ -119,9 +287,27 @@ namespace fc
          log_context    get_context()const;
          string         get_format()const;
          variant_object get_data()const;
+         /** the arguments as captured by the log macros, or null if the message holds a variant_object */
+         const log_args* get_args()const;
+         /** the call site the message was created at, or null if it was not created by a log macro with a literal format */
+         const log_site* get_site()const;
+
+         /**
+          *  @return a new message with @param c appended to the context.  Appenders
+          *  may still hold this message, so it is never modified; the new message
+          *  shares everything but the context chain with it.
+          */
+         log_message    with_context( const fc::string& c )const;
+         /** like with_context( const fc::string& ), but shares @param c instead of copying it */
+         log_message    with_context( std::shared_ptr<const fc::string> c )const;
 
       private:
-         std::shared_ptr<detail::log_message_impl> my;
+         /** records the messages the site's rate limit dropped before this one */
+         void add_suppressed( const log_site& site );
+
+         std::shared_ptr<detail::log_message_impl>       my;
+         /** when set, replaces the chain of the context in my */
+         std::shared_ptr<const detail::log_context_link> _chain;
    };
 
    void    to_variant( const log_message& l, variant& v );
@@ -157,3 +343,24 @@ namespace fc
 #define FC_LOG_MESSAGE( LOG_LEVEL, FORMAT, ... ) \
    fc::log_message( FC_LOG_CONTEXT(LOG_LEVEL), FORMAT, fc::mutable_variant_object()__VA_ARGS__ )
 
+/**
+ * @def FC_LOG_SITE(LOG_LEVEL,FORMAT)
+ *
+ * @brief Evaluates FORMAT once into _fc_log_format and declares the static fc::log_site
+ *        _fc_log_site for the enclosing log statement.  Only a string literal FORMAT is
+ *        pre-parsed, any other format is formatted from its contents for every message.
+ */
+#define FC_LOG_SITE( LOG_LEVEL, FORMAT ) \
+   auto&& _fc_log_format = FORMAT; \
+   static const fc::log_site _fc_log_site( fc::log_level::LOG_LEVEL, __FILE__, __LINE__, __func__, _fc_log_format )
+
+/**
+ * @def FC_LOG_SITE_MESSAGE(...)
+ *
+ * @brief Like FC_LOG_MESSAGE, but uses the _fc_log_site and _fc_log_format declared by
+ *        FC_LOG_SITE in the same scope.  The arguments are captured into fc::log_args
+ *        and the message is formatted from the pre-parsed format only when needed.
+ */
+#define FC_LOG_SITE_MESSAGE( ... ) \
+   fc::log_message( _fc_log_site, _fc_log_format, fc::log_args()__VA_ARGS__ )
+
@@ -0,0 +1,51 @@
+#pragma once
+#include <fc/variant_object.hpp>
+#include <memory>
+
+namespace fc
+{
+   namespace detail { struct log_scope_node; }
+   typedef std::shared_ptr<const detail::log_scope_node> log_scope_ptr;
+
+   /**
+    *  @brief attaches a key/value pair to every message logged by the current fiber
+    *  while it is in scope.
+    *
+    *  Scopes nest and form an immutable chain, so a log_context only holds a
+    *  reference to the innermost scope instead of copying the values.  Tasks
+    *  started with fc::async inherit the scope of the fiber that created them,
+    *  which lets the logs of every fiber working on one request be correlated.
+    *
+    *  @code
+    *     fc::log_scope request( "request", id );
+    *     ilog( "handling" );                    // carries request=id
+    *     fc::async( [](){ ilog( "worker" ); } ); // so does this
+    *  @endcode
+    */
+   class log_scope
+   {
+      public:
+         log_scope( const fc::string& key, const variant& value );
+         ~log_scope();
+
+         /** @return the innermost scope of the current fiber */
+         static log_scope_ptr current();
+         /** makes @param s the scope of the current fiber and returns the previous one */
+         static log_scope_ptr set_current( log_scope_ptr s );
+
+         /** flattens the chain ending at @param s, outer scopes first */
+         static variant_object to_variant_object( const log_scope_ptr& s );
+         /** rebuilds a chain from the result of to_variant_object */
+         static log_scope_ptr from_variant_object( const variant_object& o );
+
+      private:
+         log_scope( const log_scope& );
+         log_scope& operator=( const log_scope& );
+
+         /** the scope slot of the running fiber */
+         static log_scope_ptr& fiber_scope();
+
+         log_scope_ptr _prev;
+   };
+
+} // namespace fc
@@ -23,6 +23,12 @@ namespace fc
    {
       public:
          static logger get( const fc::string& name = "default");
+         /**
+          *  Returns the "default" logger.  The handle is resolved once and never
+          *  destroyed, so it can be cached by the log macros and used from
+          *  static destructors.
+          */
+         static logger& get_default();
 
          logger();
          logger( const string& name, const logger& parent = nullptr );
@@ -41,10 +47,17 @@ namespace fc
          logger     get_parent()const;
 
          void  set_name( const fc::string& n );
-         const fc::string& name()const;
+         fc::string name()const;
 
          void add_appender( const fc::shared_ptr<appender>& a );
-
+         /**
+          *  Restores the default level and removes the parent and appenders
+          *  while keeping existing handles to this logger valid.  Messages
+          *  being logged concurrently go to the appenders they started with.
+          */
+         void reset();
+
+         /** a single relaxed atomic load, cheap enough to guard every log statement */
          bool is_enabled( log_level e )const;
          void log( log_message m );
 
@@ -59,56 +72,76 @@ namespace fc
 #define fc_dlog( LOGGER, FORMAT, ... ) \
   do { \
    if( (LOGGER).is_enabled( fc::log_level::debug ) ) { \
-      (LOGGER).log( FC_LOG_MESSAGE( debug, FORMAT, __VA_ARGS__ ) ); \
+      FC_LOG_SITE( debug, FORMAT ); \
+      if( _fc_log_site.should_log( (LOGGER) ) ) \
+         (LOGGER).log( FC_LOG_SITE_MESSAGE( __VA_ARGS__ ) ); \
    } \
   } while (0)
 
 #define fc_ilog( LOGGER, FORMAT, ... ) \
   do { \
    if( (LOGGER).is_enabled( fc::log_level::info ) ) { \
-      (LOGGER).log( FC_LOG_MESSAGE( info, FORMAT, __VA_ARGS__ ) ); \
+      FC_LOG_SITE( info, FORMAT ); \
+      if( _fc_log_site.should_log( (LOGGER) ) ) \
+         (LOGGER).log( FC_LOG_SITE_MESSAGE( __VA_ARGS__ ) ); \
    } \
   } while (0)
 
 #define fc_wlog( LOGGER, FORMAT, ... ) \
   do { \
    if( (LOGGER).is_enabled( fc::log_level::warn ) ) { \
-      (LOGGER).log( FC_LOG_MESSAGE( warn, FORMAT, __VA_ARGS__ ) ); \
+      FC_LOG_SITE( warn, FORMAT ); \
+      if( _fc_log_site.should_log( (LOGGER) ) ) \
+         (LOGGER).log( FC_LOG_SITE_MESSAGE( __VA_ARGS__ ) ); \
    } \
   } while (0)
 
 #define fc_elog( LOGGER, FORMAT, ... ) \
   do { \
    if( (LOGGER).is_enabled( fc::log_level::error ) ) { \
-      (LOGGER).log( FC_LOG_MESSAGE( error, FORMAT, __VA_ARGS__ ) ); \
+      FC_LOG_SITE( error, FORMAT ); \
+      if( _fc_log_site.should_log( (LOGGER) ) ) \
+         (LOGGER).log( FC_LOG_SITE_MESSAGE( __VA_ARGS__ ) ); \
    } \
   } while (0)
 
 #define dlog( FORMAT, ... ) \
   do { \
-   if( (fc::logger::get()).is_enabled( fc::log_level::debug ) ) { \
-      (fc::logger::get()).log( FC_LOG_MESSAGE( debug, FORMAT, __VA_ARGS__ ) ); \
+   static fc::logger& _fc_site_logger = fc::logger::get_default(); \
+   if( _fc_site_logger.is_enabled( fc::log_level::debug ) ) { \
+      FC_LOG_SITE( debug, FORMAT ); \
+      if( _fc_log_site.should_log( _fc_site_logger ) ) \
+         _fc_site_logger.log( FC_LOG_SITE_MESSAGE( __VA_ARGS__ ) ); \
    } \
   } while (0)
 
 #define ilog( FORMAT, ... ) \
   do { \
-   if( (fc::logger::get()).is_enabled( fc::log_level::info ) ) { \
-      (fc::logger::get()).log( FC_LOG_MESSAGE( info, FORMAT, __VA_ARGS__ ) ); \
+   static fc::logger& _fc_site_logger = fc::logger::get_default(); \
+   if( _fc_site_logger.is_enabled( fc::log_level::info ) ) { \
+      FC_LOG_SITE( info, FORMAT ); \
+      if( _fc_log_site.should_log( _fc_site_logger ) ) \
+         _fc_site_logger.log( FC_LOG_SITE_MESSAGE( __VA_ARGS__ ) ); \
    } \
   } while (0)
 
 #define wlog( FORMAT, ... ) \
   do { \
-   if( (fc::logger::get()).is_enabled( fc::log_level::warn ) ) { \
-      (fc::logger::get()).log( FC_LOG_MESSAGE( warn, FORMAT, __VA_ARGS__ ) ); \
+   static fc::logger& _fc_site_logger = fc::logger::get_default(); \
+   if( _fc_site_logger.is_enabled( fc::log_level::warn ) ) { \
+      FC_LOG_SITE( warn, FORMAT ); \
+      if( _fc_log_site.should_log( _fc_site_logger ) ) \
+         _fc_site_logger.log( FC_LOG_SITE_MESSAGE( __VA_ARGS__ ) ); \
    } \
   } while (0)
 
 #define elog( FORMAT, ... ) \
   do { \
-   if( (fc::logger::get()).is_enabled( fc::log_level::error ) ) { \
-      (fc::logger::get()).log( FC_LOG_MESSAGE( error, FORMAT, __VA_ARGS__ ) ); \
+   static fc::logger& _fc_site_logger = fc::logger::get_default(); \
+   if( _fc_site_logger.is_enabled( fc::log_level::error ) ) { \
+      FC_LOG_SITE( error, FORMAT ); \
+      if( _fc_log_site.should_log( _fc_site_logger ) ) \
+         _fc_site_logger.log( FC_LOG_SITE_MESSAGE( __VA_ARGS__ ) ); \
    } \
   } while (0)
 
@@ -26,13 +26,40 @@ namespace fc {
       logger_config& add_appender( const string& s );
    };
 
+   /**
+    *  Bounds the volume of the log statements at matching call sites.  When
+    *  several entries match a site the one naming both file and line wins over
+    *  one naming only the file, which wins over one naming neither.
+    */
+   struct log_limit_config {
+      log_limit_config():line(0),max_per_second(0),sample_rate(0){}
+      /// file name of the call site as it appears in the log, empty matches every file
+      string                           file;
+      /// line of the call site, 0 matches every line of file
+      uint64_t                         line;
+      /// messages logged per second and site, 0 means unlimited
+      uint32_t                         max_per_second;
+      /// log one of every sample_rate messages, 0 or 1 logs all of them
+      uint32_t                         sample_rate;
+   };
+
    struct logging_config {
       static logging_config default_config();
       std::vector<string>          includes;
       std::vector<appender_config> appenders;
       std::vector<logger_config>   loggers;
+      std::vector<log_limit_config> limits;
    };
 
+   /** replaces the limits of every log call site, called by configure_logging */
+   void configure_log_limits( const std::vector<log_limit_config>& limits );
+   /**
+    *  Logs the number of messages each rate limited site dropped since its last
+    *  message, so the counts are not lost when no further message follows.  Called
+    *  by configure_logging, call it before logging is shut down.
+    */
+   void flush_suppressed_log_messages();
+
    void configure_logging( const fc::path& log_config );
    bool configure_logging( const logging_config& l );
 }
@@ -40,4 +67,5 @@ namespace fc {
 #include <fc/reflect/reflect.hpp>
 FC_REFLECT( fc::appender_config, (name)(type)(args)(enabled) )
 FC_REFLECT( fc::logger_config, (name)(parent)(level)(enabled)(additivity)(appenders) )
-FC_REFLECT( fc::logging_config, (includes)(appenders)(loggers) )
+FC_REFLECT( fc::log_limit_config, (file)(line)(max_per_second)(sample_rate) )
+FC_REFLECT( fc::logging_config, (includes)(appenders)(loggers)(limits) )
@@ -5,6 +5,7 @@
 
 namespace fc {
   namespace ip { class endpoint; } 
+  class path;
   class tcp_socket : public virtual iostream 
   {
     public:
@@ -29,6 +30,27 @@ namespace fc {
 
       bool   is_open()const;
 
+      /**
+       * @name socket options
+       * @pre the socket is connected
+       */
+      ///@{
+      void   set_no_delay( bool enable );
+      void   set_keep_alive( bool enable );
+      void   set_send_buffer_size( size_t s );
+      void   set_receive_buffer_size( size_t s );
+      ///@}
+
+      /**
+       *  Sends len bytes of the file at p starting at offset.  On Linux the
+       *  data is copied by the kernel with sendfile(2) without passing through
+       *  user space, blocking cooperatively while the send buffer is full.
+       *
+       *  @return the number of bytes sent, which is less than len only if the
+       *          file ends first
+       */
+      uint64_t send_file( const fc::path& p, uint64_t offset, uint64_t len );
+
     private:
       friend class tcp_server;
       class impl;
@@ -46,6 +68,18 @@ namespace fc {
       void close();
       void accept( tcp_socket& s );
       void listen( uint16_t port );
+
+      /**
+       * @name listen options
+       * These take effect the next time listen() is called.
+       */
+      ///@{
+      void set_reuse_address( bool enable = true );
+      /** allows several servers, generally in different threads, to accept on the same port */
+      void set_reuse_port( bool enable = true );
+      /** the maximum number of pending connections, defaults to the system maximum */
+      void set_accept_backlog( int backlog );
+      ///@}
     
     private:
       // non copyable
@@ -1,12 +1,10 @@
 #pragma once
 #include <fc/utility.hpp>
 #include <fc/shared_ptr.hpp>
+#include <fc/network/ip.hpp>
+#include <vector>
 
 namespace fc {
-  namespace ip {
-    class endpoint;
-    class address;
-  }
 
   /**
    *  The udp_socket class has reference semantics, all copies will
@@ -14,6 +12,22 @@ namespace fc {
    */
   class udp_socket {
     public:
+      /**
+       *  Describes one datagram in a call to receive_many() or send_many(),
+       *  the memory at data is owned by the caller.
+       */
+      struct datagram {
+        datagram():data(nullptr),size(0),capacity(0),truncated(false){}
+        datagram( char* d, size_t cap ):data(d),size(0),capacity(cap),truncated(false){}
+
+        char*            data;
+        size_t           size;     ///< bytes to send, or bytes received
+        size_t           capacity; ///< space available at data when receiving
+        fc::ip::endpoint endpoint; ///< destination when sending, source when receiving
+        /** set by receive_many() on Linux when the datagram did not fit in capacity and was cut off */
+        bool             truncated;
+      };
+
       udp_socket();
       udp_socket( const udp_socket& s );
       ~udp_socket();
@@ -23,10 +37,34 @@ namespace fc {
       void   bind( const fc::ip::endpoint& );
       size_t receive_from( char* b, size_t l, fc::ip::endpoint& from );
       size_t send_to( const char* b, size_t l, const fc::ip::endpoint& to ); 
+
+      /**
+       *  Receives up to count datagrams, blocking cooperatively until at least
+       *  one is available.  On Linux all ready datagrams are read with a single
+       *  recvmmsg() call.
+       *
+       *  @return the number of datagrams received, each with size and endpoint set
+       */
+      size_t receive_many( datagram* msgs, size_t count );
+
+      /**
+       *  Sends count datagrams, on Linux with as few sendmmsg() calls as the
+       *  kernel allows, blocking cooperatively while the send buffer is full.
+       *
+       *  @return the number of datagrams sent, which is always count unless an exception is thrown
+       */
+      size_t send_many( const datagram* msgs, size_t count );
       void   close();
 
       void   set_multicast_enable_loopback( bool );
       void   set_reuse_address( bool );
+      /**
+       *  Allows several sockets to bind the same endpoint, the kernel then
+       *  distributes incoming datagrams between them.
+       *
+       *  @pre open() has been called and bind() has not
+       */
+      void   set_reuse_port( bool );
       void   join_multicast_group( const fc::ip::address& a );
 
       void   connect( const fc::ip::endpoint& e );
@@ -37,4 +75,32 @@ namespace fc {
       fc::shared_ptr<impl> my;
   };
 
+  /**
+   *  A fixed set of datagram buffers carved out of a single allocation
+   *  so that receive_many() can be called in a loop without allocating.
+   */
+  class udp_datagram_batch {
+    public:
+      udp_datagram_batch( size_t count, size_t max_datagram_size = 1500 );
+
+      udp_socket::datagram*  data()        { return _msgs.data(); }
+      size_t                 size()const   { return _msgs.size(); }
+      udp_socket::datagram&  operator[]( size_t i ) { return _msgs[i]; }
+
+      /** restores the full capacity of every buffer after a receive */
+      void                   reset();
+
+    private:
+      size_t                             _max_datagram_size;
+      std::vector<char>                  _storage;
+      std::vector<udp_socket::datagram>  _msgs;
+  };
+
+  /**
+   *  Opens @param count sockets bound to @param ep with SO_REUSEPORT so that
+   *  the kernel fans incoming datagrams out between them, each socket may
+   *  then be serviced from its own fc::thread.
+   */
+  std::vector<udp_socket> open_reuse_port_group( const fc::ip::endpoint& ep, size_t count );
+
 }
@@ -0,0 +1,160 @@
+#pragma once
+#include <fc/io/buffered_iostream.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/variant_object.hpp>
+#include <fc/thread/future.hpp>
+#include <fc/log/logger.hpp>
+#include <functional>
+
+namespace fc { namespace rpc  {
+
+   namespace detail { class binary_connection_impl; }
+
+   /**
+    * @brief Implements RPC over a set of io streams using fc::raw encoding
+    *
+    * Provides the same method registry as json_connection, but each message
+    * is sent as a length-prefixed frame whose params and results are packed
+    * with fc::raw rather than converted to and from JSON text.
+    *
+    * Methods registered with add_method are called with variants, methods
+    * registered with add_raw_method or add_packed_method receive the packed
+    * bytes directly and may be used with reflected types without converting
+    * them to variants at all.
+    */
+   class binary_connection
+   {
+      public:
+         typedef std::function<variant(const variants&)>                     method;
+         typedef std::function<variant(const variant_object&)>               named_param_method;
+         typedef std::function<std::vector<char>(const std::vector<char>&)> raw_method;
+
+         binary_connection( fc::buffered_istream_ptr in, fc::buffered_ostream_ptr out );
+         ~binary_connection();
+
+         /**
+          *   Starts processing messages from input
+          */
+         future<void> exec();
+
+         logger get_logger()const;
+         void   set_logger( const logger& l );
+
+         /**
+          *  Messages of at least @param min_size bytes are sent compressed with
+          *  lz4_compress, 0 turns compression off which is the default.  Compressed
+          *  messages are always accepted, so each side may choose independently.
+          */
+         void   set_compression_threshold( uint32_t min_size );
+
+         /**
+          * @name server interface
+          *
+          * Adding methods to the interface allows the remote side
+          * to call them.
+          */
+         ///@{
+         void add_method( const fc::string& name, method );
+         void add_named_param_method( const fc::string& name, named_param_method );
+         void add_raw_method( const fc::string& name, raw_method );
+
+         /**
+          *  Registers a method that takes and returns types that can be
+          *  serialized with fc::raw, callable with packed_call<Result>()
+          */
+         template<typename Result, typename Params>
+         void add_packed_method( const fc::string& name, std::function<Result(const Params&)> m )
+         {
+            add_raw_method( name, [=]( const std::vector<char>& p ) {
+               return fc::raw::pack( m( fc::raw::unpack<Params>( p ) ) );
+            });
+         }
+         void remove_method( const fc::string& name );
+         //@}
+
+         /**
+          * @name client interface
+          */
+         ///@{
+         void notice( const fc::string& method );
+         void notice( const fc::string& method, const variants& args );
+         void notice( const fc::string& method, const variant_object& named_args );
+
+         /// args will be handled as named params
+         future<variant> async_call( const fc::string& method,
+                                     const variant_object& args );
+
+         /// Sending in an array of variants will be handled as positional arguments
+         future<variant> async_call( const fc::string& method,
+                                     const variants& args );
+
+         future<variant> async_call( const fc::string& method );
+
+         future<variant> async_call( const fc::string& method,
+                                     const variant& a1 );
+
+         future<variant> async_call( const fc::string& method,
+                                     const variant& a1,
+                                     const variant& a2 );
+
+         future<variant> async_call( const fc::string& method,
+                                     const variant& a1,
+                                     const variant& a2,
+                                     const variant& a3 );
+
+         /// Calls a method registered with add_raw_method, @param params are passed through unchanged
+         future<std::vector<char>> async_raw_call( const fc::string& method,
+                                                   const std::vector<char>& params );
+
+         template<typename Result>
+         Result call( const fc::string& method,
+                               const variant& a1,
+                               const variant& a2,
+                               const variant& a3,
+                               microseconds timeout = microseconds::maximum())
+         {
+            return async_call( method, a1, a2, a3 ).wait(timeout).as<Result>();
+         }
+
+         template<typename Result>
+         Result call( const fc::string& method,
+                               const variant& a1,
+                               const variant& a2,
+                               microseconds timeout = microseconds::maximum())
+         {
+            return async_call( method, a1, a2 ).wait(timeout).as<Result>();
+         }
+
+         template<typename Result>
+         Result call( const fc::string& method,
+                               const variant& a1,
+                               microseconds timeout = microseconds::maximum())
+         {
+            return async_call( method, a1 ).wait(timeout).as<Result>();
+         }
+
+         template<typename Result>
+         Result call( const fc::string& method, microseconds timeout = microseconds::maximum() )
+         {
+            return async_call( method ).wait(timeout).as<Result>();
+         }
+
+         /**
+          *  Calls a method registered with add_packed_method, @param params
+          *  and the result are serialized with fc::raw.
+          */
+         template<typename Result, typename Params>
+         Result packed_call( const fc::string& method,
+                             const Params& params,
+                             microseconds timeout = microseconds::maximum() )
+         {
+            return fc::raw::unpack<Result>( async_raw_call( method, fc::raw::pack( params ) ).wait(timeout) );
+         }
+         ///@}
+
+      private:
+         std::unique_ptr<detail::binary_connection_impl> my;
+   };
+   typedef std::shared_ptr<binary_connection> binary_connection_ptr;
+
+}} // fc::rpc
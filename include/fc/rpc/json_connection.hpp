@@ -13,7 +13,11 @@ namespace fc { namespace rpc  {
     * @brief Implements JSON-RPC 2.0 over a set of io streams
     *
     * Each JSON RPC message is expected to be on its own line, violators
-    * will be prosecuted to the fullest extent of the law.
+    * will be prosecuted to the fullest extent of the law.  Batch requests
+    * are answered with a single array of responses.
+    *
+    * Responses are buffered and flushed once all messages that are ready
+    * to be handled have written their results.
     */
    class json_connection
    {
@@ -44,6 +48,29 @@ namespace fc { namespace rpc  {
          void remove_method( const fc::string& name );
          //@}
 
+         /**
+          * @name dispatch tuning
+          */
+         ///@{
+         /**
+          *  Limits the number of incoming messages that may be handled at
+          *  once, when the limit is reached the read loop stops pulling
+          *  messages until one of them completes.  A batch counts as a
+          *  single message.  0 (the default) places no limit.
+          */
+         void set_max_concurrent_calls( uint32_t max_calls );
+
+         /**
+          *  Executes incoming method calls on a pool of @param num_threads
+          *  threads owned by this connection rather than on the thread that
+          *  called exec().  Methods must be thread safe if this is enabled.
+          *  0 (the default) calls methods on the exec() thread.
+          *
+          *  @pre exec() has not been called
+          */
+         void set_worker_threads( uint32_t num_threads );
+         ///@}
+
          /**
           * @name client interface
           */
@@ -1,22 +1,64 @@
 #pragma once
+#include <fc/variant.hpp>
+#include <fc/time.hpp>
+#include <memory>
 
-namespace fc 
+namespace fc
 {
+   namespace detail { class variant_stream_impl; }
 
    /**
     * Thread-safe, circular buffer for passing variants
     * between threads.
+    *
+    * Any number of producers may claim and publish slots concurrently, but
+    * there must be only one consumer.  Positions increase monotonically and
+    * are mapped onto the ring by get(), so a producer claims a range of
+    * positions, fills them in with get() and then publishes them.  The
+    * consumer reads every position in [begin(),end()) and then calls
+    * consume() to hand the slots back to the producers.
+    *
+    * @code
+    *   // producer
+    *   int64_t pos = s.claim( 2 );
+    *   s.get(pos)   = a;
+    *   s.get(pos+1) = b;
+    *   s.publish( pos, 2 );
+    *
+    *   // consumer
+    *   int64_t end = s.wait();
+    *   for( int64_t i = s.begin(); i < end; ++i ) handle( s.get(i) );
+    *   s.consume( end );
+    * @endcode
+    *
+    * Claiming, publishing and consuming never take a lock. Waiting for data
+    * or free space blocks the calling fiber rather than the OS thread.
     */
    class variant_stream
    {
      public:
+        typedef std::shared_ptr<variant_stream> ptr;
+
+        /** @param s the capacity of the ring, rounded up to a power of 2 */
         variant_stream( size_t s );
         ~variant_stream();
 
         /** producer api */
         int64_t free(); // number of spaces available
-        int64_t claim( int64_t num );
-        int64_t publish( int64_t pos );
+        /**
+         *  Reserves @param num consecutive positions, waiting for the consumer
+         *  if they are not free yet.
+         *
+         *  @return the first position claimed
+         */
+        int64_t claim( int64_t num = 1 );
+        /**
+         *  Makes the @param num positions starting at @param pos visible to the
+         *  consumer.
+         *
+         *  @return the position after the last one published
+         */
+        int64_t publish( int64_t pos, int64_t num = 1 );
         int64_t wait_free(); // wait for free space
 
         // producer/consumer api
@@ -25,12 +67,17 @@ namespace fc
         /** consumer api */
         int64_t   begin(); // returns the first index ready to be read
         int64_t   end();   // returns the first index that cannot be read
-        int64_t   wait(); // wait for variants to be posted
+        /**
+         *  Waits until variants are published or @param timeout passes.
+         *
+         *  @return end(), which equals begin() if the wait timed out
+         */
+        int64_t   wait( const microseconds& timeout = microseconds::maximum() );
+        /** releases every position before @param end back to the producers */
+        void      consume( int64_t end );
 
      private:
-        std::vector<variant>  _variants;
-        uint64_t              _read_pos;
-        uint64_t              _write_pos;
+        std::unique_ptr<detail::variant_stream_impl> my;
    };
 
 }
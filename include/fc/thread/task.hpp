@@ -3,10 +3,12 @@
 #include <fc/thread/priority.hpp>
 #include <fc/aligned.hpp>
 #include <fc/fwd.hpp>
+#include <memory>
 
 namespace fc {
   struct context;
   class spin_lock;
+  namespace detail { struct log_scope_node; }
 
   class task_base : virtual public promise_base {
     public:
@@ -20,6 +22,8 @@ namespace fc {
       void        _set_active_context(context*);
       context*    _active_context;
       task_base*  _next;
+      /** the log scope of the fiber that created the task, installed while it runs */
+      std::shared_ptr<const detail::log_scope_node> _log_scope;
 
       task_base(void* func);
       // opaque internal / private data used by
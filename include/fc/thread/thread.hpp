@@ -119,6 +119,7 @@ namespace fc {
       friend class promise_base;
       friend class thread_d;
       friend class mutex;
+      friend class log_scope;
       friend void yield();
       friend void usleep(const microseconds&);
       friend void sleep_until(const time_point&);
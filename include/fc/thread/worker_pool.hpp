@@ -0,0 +1,39 @@
+#pragma once
+#include <fc/thread/thread.hpp>
+#include <vector>
+
+namespace fc {
+
+  /**
+   *  @brief the threads that CPU bound work, such as batch signature checks,
+   *         merkle levels and compression blocks, is split over.
+   *
+   *  There is one pool per process with one fc::thread per core.  The threads
+   *  are started the first time the pool is used and are quit and joined by
+   *  shutdown(), which runs at exit if it was not called before.
+   */
+  class worker_pool
+  {
+    public:
+      static worker_pool& instance();
+
+      /** @return the number of threads, 0 once the pool has been shut down */
+      size_t  size()const { return _threads.size(); }
+
+      /** @pre i < size() */
+      thread& operator[]( size_t i )const { return *_threads[i]; }
+
+      /**
+       *  Quits and joins every thread.  Callers that find size() == 0 afterwards
+       *  run their work on the calling thread.  Must not race with users of the pool.
+       */
+      void    shutdown();
+
+    private:
+      worker_pool();
+      ~worker_pool();
+
+      std::vector<thread*> _threads;
+  };
+
+} // namespace fc
@@ -41,6 +41,11 @@ namespace fc
    void from_variant( const variant& var,  mutable_variant_object& vo );
    void to_variant( const std::vector<char>& var,  variant& vo );
    void from_variant( const variant& var,  std::vector<char>& vo );
+   /**
+    *  Reads a blob or hex string variant into a fixed size value such as a hash.
+    *  @return the number of bytes read, at most @param len
+    */
+   size_t from_variant( const variant& var,  char* data, size_t len );
 
    template<typename T>
    void to_variant( const std::unordered_set<T>& var,  variant& vo );
@@ -72,11 +77,23 @@ namespace fc
 
    typedef std::vector<variant>   variants;
 
+   /**
+    *  Binary data such as hashes and keys.  It is kept as bytes through
+    *  variant conversions and fc::raw, and only hex encoded when written
+    *  as text.
+    *
+    *  @note fc::raw packs a blob variant with type tag 8 followed by its
+    *  bytes, where hashes and byte vectors used to be packed as hex strings
+    *  with tag 5.  Readers built before blob_type reject tag 8, so packed
+    *  variants containing binary data are not readable by older peers.
+    */
+   struct blob { std::vector<char> data; };
+
    /**
     * @brief stores null, int64, uint64, double, bool, string, std::vector<variant>,
-    *        and variant_object's.  
+    *        variant_object's and blobs.  
     *
-    * variant's allocate everything but strings, arrays, and objects on the
+    * variant's allocate everything but strings, arrays, objects and blobs on the
     * stack and are 'move aware' for values allcoated on the heap.  
     *
     * Memory usage on 64 bit systems is 16 bytes and 12 bytes on 32 bit systems.
@@ -93,7 +110,8 @@ namespace fc
            bool_type   = 4,
            string_type = 5,
            array_type  = 6,
-           object_type = 7
+           object_type = 7,
+           blob_type   = 8
         };
 
         /// Constructs a null_type variant
@@ -116,6 +134,7 @@ namespace fc
         variant( variant_object );
         variant( mutable_variant_object );
         variant( variants );
+        variant( blob val );
         variant( const variant& );
         variant( variant&& );
        ~variant();
@@ -136,6 +155,8 @@ namespace fc
               virtual void handle( const string& v )const        = 0;
               virtual void handle( const variant_object& v)const = 0;
               virtual void handle( const variants& v)const       = 0;
+              /// blobs are handled as their hex string unless overridden
+              virtual void handle( const blob& v)const;
         };
 
         void  visit( const visitor& v )const;
@@ -150,6 +171,7 @@ namespace fc
         bool                        is_double()const;
         bool                        is_object()const;
         bool                        is_array()const;
+        bool                        is_blob()const;
         /**
          *   int64, uint64, double,bool
          */
@@ -160,12 +182,12 @@ namespace fc
         bool                        as_bool()const;
         double                      as_double()const;
 
-        /** Convert's double, ints, bools, etc to a string
+        /** Convert's double, ints, bools, etc to a string, blobs are hex encoded
          * @throw if get_type() == array_type | get_type() == object_type 
          */
         string                      as_string()const;
 
-        /// @pre  get_type() == string_type
+        /// @pre  get_type() == string_type | blob_type, blobs are returned hex encoded
         const string&               get_string()const;
                                     
         /// @throw if get_type() != array_type | null_type
@@ -180,6 +202,9 @@ namespace fc
         /// @throw if get_type() != object_type 
         const variant_object&       get_object()const;
 
+        /// @throw if get_type() != blob_type
+        const blob&                 get_blob()const;
+
         /// @pre is_object()
         const variant&              operator[]( const char* )const;
         /// @pre is_array()
@@ -0,0 +1,195 @@
+#include <fc/compress/lz4.hpp>
+#include <fc/exception/exception.hpp>
+#include <lz4.h>
+#include <algorithm>
+#include <string.h>
+
+namespace fc {
+
+  size_t lz4_compress_bound( size_t size )
+  {
+     FC_ASSERT( size <= LZ4_MAX_INPUT_SIZE, "lz4 blocks are limited to ${n} bytes", ("n",uint64_t(LZ4_MAX_INPUT_SIZE)) );
+     return size_t( LZ4_compressBound( int(size) ) );
+  }
+
+  size_t lz4_compress( const char* in, size_t size, char* out )
+  {
+     int n = LZ4_compress_default( in, out, int(size), int(lz4_compress_bound( size )) );
+     FC_ASSERT( n > 0 || size == 0, "lz4 compression failed" );
+     return size_t(n);
+  }
+
+  size_t lz4_decompress( const char* in, size_t size, char* out, size_t out_size )
+  {
+     FC_ASSERT( size <= LZ4_MAX_INPUT_SIZE && out_size <= LZ4_MAX_INPUT_SIZE, "lz4 block is too large" );
+     // LZ4_decompress_safe never reads or writes outside of the two buffers
+     int n = LZ4_decompress_safe( in, out, int(size), int(out_size) );
+     FC_ASSERT( n >= 0, "corrupt lz4 data or more than ${n} bytes", ("n",uint64_t(out_size)) );
+     return size_t(n);
+  }
+
+  std::vector<char> lz4_compress( const std::vector<char>& in )
+  {
+     std::vector<char> out( 4 + lz4_compress_bound( in.size() ) );
+     uint32_t size = uint32_t(in.size());
+     for( int i = 0; i < 4; ++i )
+        out[i] = char( size >> (8*i) );
+     out.resize( 4 + lz4_compress( in.data(), in.size(), out.data() + 4 ) );
+     return out;
+  }
+
+  std::vector<char> lz4_decompress( const std::vector<char>& compressed, size_t max_size )
+  {
+     FC_ASSERT( compressed.size() > 4, "corrupt lz4 data, missing its size" );
+     uint32_t size = 0;
+     for( int i = 0; i < 4; ++i )
+        size |= uint32_t( uint8_t(compressed[i]) ) << (8*i);
+     FC_ASSERT( size <= max_size, "lz4 data of ${n} bytes is too large", ("n",size) );
+
+     std::vector<char> out( size );
+     size_t n = lz4_decompress( compressed.data() + 4, compressed.size() - 4, out.data(), out.size() );
+     FC_ASSERT( n == size, "corrupt lz4 data, decompressed to ${got} bytes instead of ${n}",
+                ("got",uint64_t(n))("n",size) );
+     return out;
+  }
+
+  namespace detail
+  {
+     /** the sizes before every block of an lz4_ostream */
+     static const size_t lz4_block_header_size = 8;
+
+     static void put_le32( char* p, uint32_t v )
+     {
+        for( int i = 0; i < 4; ++i )
+           p[i] = char( v >> (8*i) );
+     }
+
+     static uint32_t get_le32( const char* p )
+     {
+        uint32_t v = 0;
+        for( int i = 0; i < 4; ++i )
+           v |= uint32_t( uint8_t(p[i]) ) << (8*i);
+        return v;
+     }
+  }
+
+  lz4_ostream::lz4_ostream( ostream_ptr sink, size_t block_size )
+  :_sink(fc::move(sink)),_block_size(block_size),_closed(false)
+  {
+     FC_ASSERT( block_size > 0 && block_size <= LZ4_MAX_INPUT_SIZE );
+     _block.reserve( _block_size );
+     _compressed.resize( detail::lz4_block_header_size + lz4_compress_bound( _block_size ) );
+  }
+
+  lz4_ostream::~lz4_ostream()
+  {
+     try { close(); } catch ( ... ) {}
+  }
+
+  void lz4_ostream::write_block()
+  {
+     if( _block.empty() ) return;
+     char*  header = _compressed.data();
+     size_t n      = lz4_compress( _block.data(), _block.size(), header + detail::lz4_block_header_size );
+     detail::put_le32( header + 4, uint32_t(_block.size()) );
+     if( n < _block.size() )
+     {
+        detail::put_le32( header, uint32_t(n) );
+        _sink->write( header, detail::lz4_block_header_size + n );
+     }
+     else
+     {
+        detail::put_le32( header, uint32_t(_block.size()) );
+        _sink->write( header, detail::lz4_block_header_size );
+        _sink->write( _block.data(), _block.size() );
+     }
+     _block.clear();
+  }
+
+  size_t lz4_ostream::writesome( const char* buf, size_t len )
+  {
+     FC_ASSERT( !_closed, "lz4 stream is closed" );
+     len = std::min( len, _block_size - _block.size() );
+     _block.insert( _block.end(), buf, buf + len );
+     if( _block.size() == _block_size )
+        write_block();
+     return len;
+  }
+
+  void lz4_ostream::flush()
+  {
+     FC_ASSERT( !_closed, "lz4 stream is closed" );
+     write_block();
+     _sink->flush();
+  }
+
+  void lz4_ostream::close()
+  {
+     if( _closed ) return;
+     write_block();
+     _closed = true;
+
+     char end[detail::lz4_block_header_size] = {0};
+     _sink->write( end, sizeof(end) );
+     _sink->close();
+  }
+
+  lz4_istream::lz4_istream( istream_ptr source, size_t max_block_size )
+  :_source(fc::move(source)),_max_block_size(max_block_size),_pos(0),_done(false)
+  {
+  }
+
+  lz4_istream::~lz4_istream(){}
+
+  bool lz4_istream::next_block()
+  {
+     char header[detail::lz4_block_header_size];
+     try {
+        _source->read( header, sizeof(header) );
+     } catch ( const eof_exception& ) {
+        FC_THROW_EXCEPTION( parse_error_exception, "lz4 stream ended without its end block" );
+     }
+     uint32_t stored_size = detail::get_le32( header );
+     uint32_t size        = detail::get_le32( header + 4 );
+     if( stored_size == 0 ) return false;
+
+     FC_ASSERT( size <= _max_block_size && stored_size <= size,
+                "corrupt lz4 stream, block of ${c} bytes that decompresses to ${n}",
+                ("c",stored_size)("n",size) );
+     _plain.resize( size );
+     _pos = 0;
+     try {
+        if( stored_size == size )
+        {
+           _source->read( _plain.data(), size );
+           return true;
+        }
+        _compressed.resize( stored_size );
+        _source->read( _compressed.data(), stored_size );
+     } catch ( const eof_exception& ) {
+        // the caller would take an eof for the end of the stream
+        FC_THROW_EXCEPTION( parse_error_exception, "lz4 stream ended inside a block" );
+     }
+     size_t n = lz4_decompress( _compressed.data(), stored_size, _plain.data(), size );
+     FC_ASSERT( n == size, "corrupt lz4 stream, block decompressed to ${got} bytes instead of ${n}",
+                ("got",uint64_t(n))("n",size) );
+     return true;
+  }
+
+  size_t lz4_istream::readsome( char* buf, size_t len )
+  {
+     while( _pos == _plain.size() )
+     {
+        if( _done || !next_block() )
+        {
+           _done = true;
+           FC_THROW_EXCEPTION( eof_exception, "lz4 stream" );
+        }
+     }
+     size_t n = std::min( len, _plain.size() - _pos );
+     memcpy( buf, _plain.data() + _pos, n );
+     _pos += n;
+     return n;
+  }
+
+} // namespace fc
@@ -0,0 +1,324 @@
+#include <fc/compress/lzma.hpp>
+#include <fc/filesystem.hpp>
+#include <fc/exception/exception.hpp>
+#include <fc/thread/worker_pool.hpp>
+#include <easylzma/compress.h>
+#include <easylzma/decompress.h>
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <string.h>
+
+namespace fc {
+
+  static int read_file( void* ctx, void* buf, size_t* size )
+  {
+     std::ifstream& in = *static_cast<std::ifstream*>(ctx);
+     in.read( static_cast<char*>(buf), *size );
+     *size = size_t(in.gcount());
+     return in.bad() ? -1 : 0;
+  }
+
+  static size_t write_file( void* ctx, const void* buf, size_t size )
+  {
+     std::ofstream& out = *static_cast<std::ofstream*>(ctx);
+     out.write( static_cast<const char*>(buf), size );
+     return out.good() ? size : 0;
+  }
+
+  namespace detail
+  {
+     /** the crc32 and uncompressed size that end an lzip member */
+     static const size_t lzip_footer_size = 12;
+
+     struct memory_source
+     {
+        const char* pos;
+        const char* end;
+     };
+
+     static int read_memory( void* ctx, void* buf, size_t* size )
+     {
+        memory_source& in = *static_cast<memory_source*>(ctx);
+        size_t left = size_t(in.end - in.pos);
+        size_t n    = std::min( *size, left );
+        // the decompressor only reads the lzip footer if it comes in the same
+        // read as the end of the lzma data, so never split the last 13 bytes
+        if( n < left && left - n <= lzip_footer_size && left > lzip_footer_size + 1 )
+           n = left - lzip_footer_size - 1;
+        memcpy( buf, in.pos, n );
+        in.pos += n;
+        *size   = n;
+        return 0;
+     }
+
+     static size_t write_memory( void* ctx, const void* buf, size_t size )
+     {
+        std::vector<char>& out = *static_cast<std::vector<char>*>(ctx);
+        out.insert( out.end(), static_cast<const char*>(buf), static_cast<const char*>(buf) + size );
+        return size;
+     }
+
+     /** appends @param len bytes at @param data to @param out as one lzip member */
+     static void compress( const char* data, size_t len, unsigned char level, std::vector<char>& out )
+     {
+        memory_source in = { data, data + len };
+        elzma_compress_handle h = elzma_compress_alloc();
+        FC_ASSERT( h != NULL );
+
+        int rc = elzma_compress_config( h, ELZMA_LC_DEFAULT, ELZMA_LP_DEFAULT, ELZMA_PB_DEFAULT,
+                                        level, elzma_get_dict_size( len ), ELZMA_lzip, len );
+        if( rc == ELZMA_E_OK )
+           rc = elzma_compress_run( h, read_memory, &in, write_memory, &out, NULL, NULL );
+        elzma_compress_free( &h );
+        FC_ASSERT( rc == ELZMA_E_OK, "lzma compression failed with error ${rc}", ("rc",rc) );
+     }
+
+     /** appends the lzip member at @param data to @param out */
+     static void decompress( const char* data, size_t len, std::vector<char>& out )
+     {
+        memory_source in = { data, data + len };
+        elzma_decompress_handle h = elzma_decompress_alloc();
+        FC_ASSERT( h != NULL );
+
+        int rc = elzma_decompress_run( h, read_memory, &in, write_memory, &out, ELZMA_lzip );
+        elzma_decompress_free( &h );
+        FC_ASSERT( rc == ELZMA_E_OK, "lzma decompression failed with error ${rc}", ("rc",rc) );
+     }
+
+     /** the sizes before every block of an lzma_ostream */
+     static const size_t block_header_size = 8;
+
+     static void put_le32( char* p, uint32_t v )
+     {
+        for( int i = 0; i < 4; ++i )
+           p[i] = char( v >> (8*i) );
+     }
+
+     static uint32_t get_le32( const char* p )
+     {
+        uint32_t v = 0;
+        for( int i = 0; i < 4; ++i )
+           v |= uint32_t( uint8_t(p[i]) ) << (8*i);
+        return v;
+     }
+
+     /** @return @param block as written by an lzma_ostream, sizes first */
+     static std::vector<char> compress_block( const std::vector<char>& block, unsigned char level )
+     {
+        std::vector<char> out( block_header_size );
+        compress( block.data(), block.size(), level, out );
+        put_le32( out.data(), uint32_t( out.size() - block_header_size ) );
+        put_le32( out.data() + 4, uint32_t( block.size() ) );
+        return out;
+     }
+
+     class lzma_ostream_impl
+     {
+        public:
+           lzma_ostream_impl( ostream_ptr sink, unsigned char level, size_t block_size, uint32_t threads )
+           :_sink(fc::move(sink)),_level(level),_block_size(block_size),_threads(threads),_next_thread(0),_closed(false)
+           {
+              FC_ASSERT( block_size > 0 && block_size <= 0xffffffffu );
+              uint32_t cores = std::max<uint32_t>( uint32_t( worker_pool::instance().size() ), 1 );
+              if( _threads == 0 || _threads > cores ) _threads = cores;
+              _block.reserve( _block_size );
+           }
+
+           /** hands the current block to the pool, waiting for the oldest if too many are in flight */
+           void submit()
+           {
+              if( _block.empty() ) return;
+              if( _pending.size() >= _threads ) write_next();
+
+              auto block = std::make_shared< std::vector<char> >();
+              block->swap( _block );
+              _block.reserve( _block_size );
+
+              unsigned char level = _level;
+              worker_pool& pool = worker_pool::instance();
+              if( pool.size() == 0 )
+              {
+                 // the pool has been shut down, compress on this thread instead
+                 drain();
+                 std::vector<char> out = compress_block( *block, level );
+                 _sink->write( out.data(), out.size() );
+                 return;
+              }
+              _pending.push_back( pool[_next_thread++ % pool.size()].async( [block,level]() {
+                 return compress_block( *block, level );
+              }, "lzma_ostream" ) );
+           }
+
+           /** writes the oldest block in flight, in the order they were submitted */
+           void write_next()
+           {
+              const std::vector<char>& out = _pending.front().wait();
+              _sink->write( out.data(), out.size() );
+              _pending.pop_front();
+           }
+
+           void drain()
+           {
+              while( _pending.size() )
+                 write_next();
+           }
+
+           ostream_ptr                                     _sink;
+           unsigned char                                   _level;
+           size_t                                          _block_size;
+           uint32_t                                        _threads;
+           uint32_t                                        _next_thread;
+           std::vector<char>                               _block;
+           std::deque< fc::future< std::vector<char> > >   _pending;
+           bool                                            _closed;
+     };
+
+     class lzma_istream_impl
+     {
+        public:
+           lzma_istream_impl( istream_ptr source, size_t max_block_size )
+           :_source(fc::move(source)),_max_block_size(max_block_size),_pos(0),_done(false){}
+
+           /** @return false after the block that ends the stream */
+           bool next_block()
+           {
+              char header[block_header_size];
+              try {
+                 _source->read( header, sizeof(header) );
+              } catch ( const eof_exception& ) {
+                 FC_THROW_EXCEPTION( parse_error_exception, "lzma stream ended without its end block" );
+              }
+              uint32_t compressed_size = get_le32( header );
+              uint32_t size            = get_le32( header + 4 );
+              if( compressed_size == 0 ) return false;
+
+              FC_ASSERT( size <= _max_block_size && compressed_size <= 2 * _max_block_size + 4096,
+                         "corrupt lzma stream, block of ${c} bytes that decompress to ${n}",
+                         ("c",compressed_size)("n",size) );
+              _compressed.resize( compressed_size );
+              try {
+                 _source->read( _compressed.data(), _compressed.size() );
+              } catch ( const eof_exception& ) {
+                 // the caller would take an eof for the end of the stream
+                 FC_THROW_EXCEPTION( parse_error_exception, "lzma stream ended inside a block" );
+              }
+
+              _plain.clear();
+              _plain.reserve( size );
+              decompress( _compressed.data(), _compressed.size(), _plain );
+              FC_ASSERT( _plain.size() == size, "corrupt lzma stream, block decompressed to ${got} bytes instead of ${n}",
+                         ("got",uint64_t(_plain.size()))("n",size) );
+              _pos = 0;
+              return true;
+           }
+
+           istream_ptr       _source;
+           size_t            _max_block_size;
+           std::vector<char> _compressed;
+           std::vector<char> _plain;
+           size_t            _pos;
+           bool              _done;
+     };
+  } // namespace detail
+
+  std::vector<char> lzma_compress( const std::vector<char>& in, unsigned char level )
+  {
+     std::vector<char> out;
+     detail::compress( in.data(), in.size(), level, out );
+     return out;
+  }
+
+  std::vector<char> lzma_decompress( const std::vector<char>& compressed )
+  {
+     std::vector<char> out;
+     detail::decompress( compressed.data(), compressed.size(), out );
+     return out;
+  }
+
+  void lzma_compress_file( const path& src, const path& dst, unsigned char level )
+  {
+     std::ifstream in( src.string().c_str(), std::ios::in | std::ios::binary );
+     FC_ASSERT( in.is_open(), "unable to open ${src}", ("src",src) );
+     std::ofstream out( dst.string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+     FC_ASSERT( out.is_open(), "unable to create ${dst}", ("dst",dst) );
+
+     uint64_t size = fc::file_size( src );
+     elzma_compress_handle h = elzma_compress_alloc();
+     FC_ASSERT( h != NULL );
+
+     int rc = elzma_compress_config( h, ELZMA_LC_DEFAULT, ELZMA_LP_DEFAULT, ELZMA_PB_DEFAULT,
+                                     level, elzma_get_dict_size( size ), ELZMA_lzip, size );
+     if( rc == ELZMA_E_OK )
+        rc = elzma_compress_run( h, read_file, &in, write_file, &out, NULL, NULL );
+     elzma_compress_free( &h );
+
+     FC_ASSERT( rc == ELZMA_E_OK, "compressing ${src} failed with error ${rc}", ("src",src)("rc",rc) );
+     out.flush();
+     FC_ASSERT( out.good(), "error writing ${dst}", ("dst",dst) );
+  }
+
+  lzma_ostream::lzma_ostream( ostream_ptr sink, unsigned char level, size_t block_size, uint32_t threads )
+  :my( new detail::lzma_ostream_impl( fc::move(sink), level, block_size, threads ) )
+  {
+  }
+
+  lzma_ostream::~lzma_ostream()
+  {
+     try { close(); } catch ( ... ) {}
+  }
+
+  size_t lzma_ostream::writesome( const char* buf, size_t len )
+  {
+     FC_ASSERT( !my->_closed, "lzma stream is closed" );
+     len = std::min( len, my->_block_size - my->_block.size() );
+     my->_block.insert( my->_block.end(), buf, buf + len );
+     if( my->_block.size() == my->_block_size )
+        my->submit();
+     return len;
+  }
+
+  void lzma_ostream::flush()
+  {
+     FC_ASSERT( !my->_closed, "lzma stream is closed" );
+     my->submit();
+     my->drain();
+     my->_sink->flush();
+  }
+
+  void lzma_ostream::close()
+  {
+     if( my->_closed ) return;
+     my->submit();
+     my->drain();
+     my->_closed = true;
+
+     char end[detail::block_header_size] = {0};
+     my->_sink->write( end, sizeof(end) );
+     my->_sink->close();
+  }
+
+  lzma_istream::lzma_istream( istream_ptr source, size_t max_block_size )
+  :my( new detail::lzma_istream_impl( fc::move(source), max_block_size ) )
+  {
+  }
+
+  lzma_istream::~lzma_istream(){}
+
+  size_t lzma_istream::readsome( char* buf, size_t len )
+  {
+     while( my->_pos == my->_plain.size() )
+     {
+        if( my->_done || !my->next_block() )
+        {
+           my->_done = true;
+           FC_THROW_EXCEPTION( eof_exception, "lzma stream" );
+        }
+     }
+     size_t n = std::min( len, my->_plain.size() - my->_pos );
+     memcpy( buf, my->_plain.data() + my->_pos, n );
+     my->_pos += n;
+     return n;
+  }
+
+} // namespace fc
@@ -1,6 +1,8 @@
-#include <fc/crypto/sha512.hpp>
+#include <fc/crypto/aes.hpp>
 #include <fc/crypto/openssl.hpp>
 #include <fc/exception/exception.hpp>
+#include <string.h>
+#include <limits>
 
 namespace fc {
 
@@ -127,4 +129,295 @@ std::vector<char> aes_decrypt( const fc::sha512& key, const std::vector<char>& c
     return plain_text;
 }
 
+namespace detail
+{
+    /** the state shared by aes_encoder and aes_decoder */
+    class aes_cipher_impl
+    {
+       public:
+          aes_cipher_impl( bool e ):ctx( EVP_CIPHER_CTX_new() ),encrypt(e),mode(aes_mode::cbc),initialized(false)
+          {
+             if( !ctx )
+                FC_THROW_EXCEPTION( exception, "error allocating evp cipher context",
+                                   ("s", ERR_error_string( ERR_get_error(), nullptr) ) );
+          }
+
+          void check( int r, const char* what )
+          {
+             if( r != 1 )
+                FC_THROW_EXCEPTION( exception, "error during aes ${what}",
+                                   ("what",what)("s", ERR_error_string( ERR_get_error(), nullptr) ) );
+          }
+
+          void init( const fc::sha256& key, const char* iv, aes_mode::type m )
+          {
+             mode = m;
+             const EVP_CIPHER* cipher = m == aes_mode::gcm ? EVP_aes_256_gcm() : EVP_aes_256_cbc();
+             // the key schedule is computed here, reset() only replaces the iv
+             check( EVP_CipherInit_ex( ctx, cipher, NULL, (const unsigned char*)&key,
+                                       (const unsigned char*)iv, encrypt ? 1 : 0 ), "init" );
+             initialized = true;
+          }
+
+          void reset( const char* iv )
+          {
+             FC_ASSERT( initialized, "aes cipher must be initialized with a key first" );
+             check( EVP_CipherInit_ex( ctx, NULL, NULL, NULL, (const unsigned char*)iv, encrypt ? 1 : 0 ), "reset" );
+          }
+
+          void authenticate( const char* data, size_t len )
+          {
+             FC_ASSERT( mode == aes_mode::gcm, "only gcm authenticates additional data" );
+             FC_ASSERT( len <= size_t(std::numeric_limits<int>::max()) );
+             int out_len = 0;
+             check( EVP_CipherUpdate( ctx, NULL, &out_len, (const unsigned char*)data, int(len) ), "authenticate" );
+          }
+
+          size_t update( const char* in, size_t len, char* out )
+          {
+             FC_ASSERT( initialized, "aes cipher must be initialized with a key first" );
+             FC_ASSERT( len <= size_t(std::numeric_limits<int>::max()) - 16 );
+             int out_len = 0;
+             check( EVP_CipherUpdate( ctx, (unsigned char*)out, &out_len, (const unsigned char*)in, int(len) ), "update" );
+             return size_t(out_len);
+          }
+
+          size_t final( char* out )
+          {
+             FC_ASSERT( initialized, "aes cipher must be initialized with a key first" );
+             int out_len = 0;
+             if( 1 != EVP_CipherFinal_ex( ctx, (unsigned char*)out, &out_len ) )
+             {
+                if( mode == aes_mode::gcm && !encrypt )
+                   FC_THROW_EXCEPTION( exception, "aes gcm authentication failed" );
+                check( 0, "final" );
+             }
+             return size_t(out_len);
+          }
+
+          evp_cipher_ctx ctx;
+          bool           encrypt;
+          aes_mode::type mode;
+          bool           initialized;
+    };
+}
+
+aes_encoder::aes_encoder():my( new detail::aes_cipher_impl(true) ){}
+aes_encoder::~aes_encoder(){}
+
+void aes_encoder::init( const fc::sha256& key, const char* iv, aes_mode::type mode ) { my->init( key, iv, mode ); }
+void aes_encoder::reset( const char* iv )                                            { my->reset( iv ); }
+void aes_encoder::authenticate( const char* data, size_t len )                       { my->authenticate( data, len ); }
+
+size_t aes_encoder::encode( const char* plain_text, size_t len, char* cipher_text )
+{
+   return my->update( plain_text, len, cipher_text );
+}
+size_t aes_encoder::final_encode( char* cipher_text )
+{
+   return my->final( cipher_text );
+}
+
+aes_tag aes_encoder::tag()const
+{
+   FC_ASSERT( my->mode == aes_mode::gcm, "only gcm produces a tag" );
+   aes_tag t;
+   my->check( EVP_CIPHER_CTX_ctrl( my->ctx, EVP_CTRL_GCM_GET_TAG, sizeof(t), t.data ), "get tag" );
+   return t;
+}
+
+aes_decoder::aes_decoder():my( new detail::aes_cipher_impl(false) ){}
+aes_decoder::~aes_decoder(){}
+
+void aes_decoder::init( const fc::sha256& key, const char* iv, aes_mode::type mode ) { my->init( key, iv, mode ); }
+void aes_decoder::reset( const char* iv )                                            { my->reset( iv ); }
+void aes_decoder::authenticate( const char* data, size_t len )                       { my->authenticate( data, len ); }
+
+size_t aes_decoder::decode( const char* cipher_text, size_t len, char* plain_text )
+{
+   return my->update( cipher_text, len, plain_text );
+}
+
+void aes_decoder::set_tag( const aes_tag& t )
+{
+   FC_ASSERT( my->mode == aes_mode::gcm, "only gcm checks a tag" );
+   my->check( EVP_CIPHER_CTX_ctrl( my->ctx, EVP_CTRL_GCM_SET_TAG, sizeof(t), (void*)t.data ), "set tag" );
+}
+size_t aes_decoder::final_decode( char* plain_text )
+{
+   return my->final( plain_text );
+}
+
+/** the most plain text the streams process at once, and the size of a gcm record */
+static const size_t aes_stream_chunk = 64*1024;
+static const size_t gcm_iv_size      = 12;
+
+/** the iv of gcm record @param n, the iv of the stream with n xored into its last 8 bytes */
+static void gcm_record_iv( const char* iv, uint64_t n, char* out )
+{
+   memcpy( out, iv, gcm_iv_size );
+   for( int i = 0; i < 8; ++i )
+      out[gcm_iv_size - 1 - i] ^= char( n >> (8*i) );
+}
+
+aes_ostream::aes_ostream( ostream_ptr sink, const fc::sha256& key, const char* iv, aes_mode::type mode )
+:_sink(sink),_mode(mode),_buffer(aes_stream_chunk + 16 + sizeof(aes_tag)),_records(0),_closed(false)
+{
+   _encoder.init( key, iv, mode );
+   if( mode == aes_mode::gcm )
+   {
+      memcpy( _iv, iv, sizeof(_iv) );
+      _plain.reserve( aes_stream_chunk );
+   }
+}
+aes_ostream::~aes_ostream()
+{
+   try { close(); } catch ( ... ) {}
+}
+
+size_t aes_ostream::writesome( const char* buf, size_t len )
+{
+   FC_ASSERT( !_closed, "aes stream is closed" );
+   if( _mode == aes_mode::gcm )
+   {
+      // a full record is sealed once more data shows that it is not the last one
+      if( _plain.size() == aes_stream_chunk )
+         seal( false );
+      len = std::min( len, aes_stream_chunk - _plain.size() );
+      _plain.insert( _plain.end(), buf, buf + len );
+      return len;
+   }
+   len = std::min( len, aes_stream_chunk );
+   size_t n = _encoder.encode( buf, len, _buffer.data() );
+   _sink->write( _buffer.data(), n );
+   return len;
+}
+
+void aes_ostream::seal( bool last )
+{
+   char iv[gcm_iv_size];
+   gcm_record_iv( _iv, _records++, iv );
+   _encoder.reset( iv );
+   char flag = last ? 1 : 0;
+   _encoder.authenticate( &flag, 1 );
+
+   size_t n = _encoder.encode( _plain.data(), _plain.size(), _buffer.data() );
+   n += _encoder.final_encode( _buffer.data() + n );
+   aes_tag t = _encoder.tag();
+   memcpy( _buffer.data() + n, t.data, sizeof(t) );
+   _sink->write( _buffer.data(), n + sizeof(t) );
+   _plain.clear();
+}
+
+void aes_ostream::close()
+{
+   if( _closed ) return;
+   _closed = true;
+   if( _mode == aes_mode::gcm )
+      seal( true );
+   else
+   {
+      size_t n = _encoder.final_encode( _buffer.data() );
+      _sink->write( _buffer.data(), n );
+   }
+   _sink->close();
+}
+
+void aes_ostream::flush()
+{
+   _sink->flush();
+}
+
+aes_istream::aes_istream( istream_ptr source, const fc::sha256& key, const char* iv, aes_mode::type mode )
+:_source(source),_mode(mode),_cipher(aes_stream_chunk),_plain_pos(0),_records(0),_done(false)
+{
+   _decoder.init( key, iv, mode );
+   if( mode == aes_mode::gcm )
+      memcpy( _iv, iv, sizeof(_iv) );
+}
+aes_istream::~aes_istream(){}
+
+void aes_istream::finish()
+{
+   _done = true;
+   _plain.resize( 16 );
+   _plain_pos = 0;
+   _plain.resize( _decoder.final_decode( _plain.data() ) );
+}
+
+void aes_istream::open_record( size_t len, bool last )
+{
+   FC_ASSERT( len >= sizeof(aes_tag), "aes gcm record is missing its tag" );
+   char iv[gcm_iv_size];
+   gcm_record_iv( _iv, _records++, iv );
+   _decoder.reset( iv );
+   char flag = last ? 1 : 0;
+   _decoder.authenticate( &flag, 1 );
+
+   size_t cipher_len = len - sizeof(aes_tag);
+   aes_tag t;
+   memcpy( t.data, _held.data() + cipher_len, sizeof(t) );
+   _plain_pos = 0;
+   _plain.resize( cipher_len + 16 );
+   try {
+      size_t n = _decoder.decode( _held.data(), cipher_len, _plain.data() );
+      _decoder.set_tag( t );
+      n += _decoder.final_decode( _plain.data() + n );
+      _plain.resize( n );
+   } catch ( ... ) {
+      // nothing of a record that fails authentication is ever returned
+      _plain.clear();
+      _done = true;
+      throw;
+   }
+   _held.erase( _held.begin(), _held.begin() + len );
+}
+
+size_t aes_istream::readsome( char* buf, size_t len )
+{
+   for( ;; )
+   {
+      if( _plain_pos < _plain.size() )
+      {
+         size_t n = std::min( len, _plain.size() - _plain_pos );
+         memcpy( buf, _plain.data() + _plain_pos, n );
+         _plain_pos += n;
+         return n;
+      }
+      if( _done )
+         FC_THROW_EXCEPTION( eof_exception, "aes stream" );
+
+      // a full gcm record is complete once more data follows it
+      const size_t record = aes_stream_chunk + sizeof(aes_tag);
+      if( _mode == aes_mode::gcm && _held.size() > record )
+      {
+         open_record( record, false );
+         continue;
+      }
+
+      size_t got = 0;
+      try {
+         got = _source->readsome( _cipher.data(), _cipher.size() );
+      } catch ( const eof_exception& ) {
+         if( _mode == aes_mode::gcm )
+         {
+            _done = true;
+            open_record( _held.size(), true );
+         }
+         else
+            finish();
+         continue;
+      }
+
+      if( _mode == aes_mode::gcm )
+         _held.insert( _held.end(), _cipher.data(), _cipher.data() + got );
+      else
+      {
+         _plain.resize( got + 16 );
+         _plain.resize( _decoder.decode( _cipher.data(), got, _plain.data() ) );
+         _plain_pos = 0;
+      }
+   }
+}
+
 }  // namespace fc
@@ -1,5 +1,5 @@
 #include <fc/crypto/base64.hpp>
-#include <ctype.h>
+#include <stdint.h>
 /* 
    base64.cpp and base64.h
 
@@ -25,114 +25,94 @@
 
    René Nyffenegger rene.nyffenegger@adp-gmbh.ch
 
+   Altered for fc: the encoder and decoder are table driven and write into
+   preallocated strings instead of appending a character at a time.
+
 */
 
 namespace fc {
 
-inline const std::string& base64_chars()
-{
-    static const std::string m_base64_chars = 
-                 "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-                 "abcdefghijklmnopqrstuvwxyz"
-                 "0123456789+/";
-    return m_base64_chars;
-}
-
-static inline bool is_base64(unsigned char c) {
-  return (isalnum(c) || (c == '+') || (c == '/'));
-}
+static const char base64_chars[] =
+             "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+             "abcdefghijklmnopqrstuvwxyz"
+             "0123456789+/";
 
-std::string base64_encode(unsigned char const* bytes_to_encode, unsigned int in_len);
+/** the value of every character, -1 if it is not a base64 digit */
+struct base64_table
+{
+   base64_table()
+   {
+      for( int i = 0; i < 256; ++i ) value[i] = -1;
+      for( int i = 0; i < 64; ++i )  value[(unsigned char)base64_chars[i]] = (signed char)i;
+   }
+   signed char value[256];
+};
+static const base64_table base64_values;
 
 std::string base64_encode( const std::string& enc ) {
   char const* s = enc.c_str();
   return base64_encode( (unsigned char const*)s, enc.size() );
 }
 std::string base64_encode(unsigned char const* bytes_to_encode, unsigned int in_len) {
-
-  std::string ret;
-  int i = 0;
-  int j = 0;
-  unsigned char char_array_3[3];
-  unsigned char char_array_4[4];
-
-  while (in_len--) {
-    char_array_3[i++] = *(bytes_to_encode++);
-    if (i == 3) {
-      char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-      char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-      char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-      char_array_4[3] = char_array_3[2] & 0x3f;
-
-      for(i = 0; (i <4) ; i++)
-        ret += base64_chars()[char_array_4[i]];
-      i = 0;
-    }
+  std::string ret( (size_t(in_len) + 2) / 3 * 4, '=' );
+  char* out = &ret[0];
+
+  const unsigned char* in  = bytes_to_encode;
+  const unsigned char* end = in + in_len / 3 * 3;
+  for( ; in != end; in += 3, out += 4 ) {
+    uint32_t v = (uint32_t(in[0]) << 16) | (uint32_t(in[1]) << 8) | in[2];
+    out[0] = base64_chars[(v >> 18) & 0x3f];
+    out[1] = base64_chars[(v >> 12) & 0x3f];
+    out[2] = base64_chars[(v >> 6)  & 0x3f];
+    out[3] = base64_chars[v & 0x3f];
   }
 
-  if (i)
-  {
-    for(j = i; j < 3; j++)
-      char_array_3[j] = '\0';
-
-    char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-    char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-    char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-    char_array_4[3] = char_array_3[2] & 0x3f;
-
-    for (j = 0; (j < i + 1); j++)
-      ret += base64_chars()[char_array_4[j]];
-
-    while((i++ < 3))
-      ret += '=';
-
+  // the padding '=' are already in place
+  switch( in_len % 3 ) {
+    case 1:
+      out[0] = base64_chars[in[0] >> 2];
+      out[1] = base64_chars[(in[0] & 0x03) << 4];
+      break;
+    case 2:
+      out[0] = base64_chars[in[0] >> 2];
+      out[1] = base64_chars[((in[0] & 0x03) << 4) | (in[1] >> 4)];
+      out[2] = base64_chars[(in[1] & 0x0f) << 2];
+      break;
   }
-
   return ret;
-
 }
 
-
+/**
+ *  Decoding stops at the first '=' or character that is not base64, a
+ *  trailing group of two or three digits decodes to one or two bytes.
+ */
 std::string base64_decode(std::string const& encoded_string) {
-  int in_len = encoded_string.size();
-  int i = 0;
-  int j = 0;
-  int in_ = 0;
-  unsigned char char_array_4[4], char_array_3[3];
-  std::string ret;
-
-  while (in_len-- && ( encoded_string[in_] != '=') && is_base64(encoded_string[in_])) {
-    char_array_4[i++] = encoded_string[in_]; in_++;
-    if (i ==4) {
-      for (i = 0; i <4; i++)
-        char_array_4[i] = base64_chars().find(char_array_4[i]);
-
-      char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-      char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-      char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-
-      for (i = 0; (i < 3); i++)
-        ret += char_array_3[i];
-      i = 0;
-    }
+  const unsigned char* in  = (const unsigned char*)encoded_string.data();
+  const unsigned char* end = in;
+  const unsigned char* lim = in + encoded_string.size();
+  while( end != lim && base64_values.value[*end] >= 0 ) ++end;
+
+  size_t digits = end - in;
+  std::string ret( digits / 4 * 3 + (digits % 4 ? digits % 4 - 1 : 0), '\0' );
+  char* out = &ret[0];
+
+  const unsigned char* full = in + digits / 4 * 4;
+  for( ; in != full; in += 4, out += 3 ) {
+    uint32_t v = (uint32_t(base64_values.value[in[0]]) << 18) | (uint32_t(base64_values.value[in[1]]) << 12) |
+                 (uint32_t(base64_values.value[in[2]]) << 6)  |  uint32_t(base64_values.value[in[3]]);
+    out[0] = char(v >> 16);
+    out[1] = char(v >> 8);
+    out[2] = char(v);
   }
 
-  if (i) {
-    for (j = i; j <4; j++)
-      char_array_4[j] = 0;
-
-    for (j = 0; j <4; j++)
-      char_array_4[j] = base64_chars().find(char_array_4[j]);
-
-    char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-    char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-    char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-
-    for (j = 0; (j < i - 1); j++) ret += char_array_3[j];
+  if( digits % 4 ) {
+    uint32_t v = 0;
+    for( size_t i = 0; i < 4; ++i )
+      v = (v << 6) | (in + i < end ? uint32_t(base64_values.value[in[i]]) : 0);
+    for( size_t i = 0; i + 1 < digits % 4; ++i )
+      out[i] = char(v >> (16 - 8 * i));
   }
-
   return ret;
 }
 
 } // namespace fc
-
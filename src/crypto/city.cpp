@@ -33,8 +33,9 @@
 #include <algorithm>
 #include <string.h>  // for memcpy and memset
 #include <fc/crypto/city.hpp>
+#include <fc/crypto/crc.hpp>
 
-uint64_t _mm_crc32_u64(uint64_t a, uint64_t b );
+uint32_t crc32cSlicingBy8(uint32_t crc, const void* data, size_t length);
 
 namespace fc {
 
@@ -382,11 +383,27 @@ uint128 city_hash128(const char *s, size_t len) {
   }
 }
 
-//#ifdef __SSE4_2__
-//#include "citycrc.h"
-//#include <nmmintrin.h>
+// The crc step of CityHashCrc256Long, in software and with the SSE4.2
+// instruction.  The instruction is emitted with inline asm so that it can
+// be selected at runtime without compiling everything for SSE4.2.
+struct CrcSoftware {
+  static inline uint64_t Crc(uint64_t crc, uint64_t v) {
+    return crc32cSlicingBy8(static_cast<uint32_t>(crc), &v, sizeof(v));
+  }
+};
+#if defined(__GNUC__) && defined(__x86_64__)
+struct CrcHardware {
+  static inline uint64_t Crc(uint64_t crc, uint64_t v) {
+    __asm__("crc32q %1, %0" : "+r"(crc) : "rm"(v));
+    return crc;
+  }
+};
+#else
+typedef CrcSoftware CrcHardware;
+#endif
 
 // Requires len >= 240.
+template<typename CrcStep>
 static void CityHashCrc256Long(const char *s, size_t len,
                                uint32_t seed, uint64_t *result) {
   uint64_t a = Fetch64(s + 56) + k0;
@@ -415,11 +432,11 @@ static void CityHashCrc256Long(const char *s, size_t len,
       e = Rotate(t, 25 ^ z) * multiplier + Fetch64(s + 32);     \
       t = old_a;                                                \
     }                                                           \
-    f = _mm_crc32_u64(f, a);                                    \
-    g = _mm_crc32_u64(g, b);                                    \
-    h = _mm_crc32_u64(h, c);                                    \
-    i = _mm_crc32_u64(i, d);                                    \
-    j = _mm_crc32_u64(j, e);                                    \
+    f = CrcStep::Crc(f, a);                                     \
+    g = CrcStep::Crc(g, b);                                     \
+    h = CrcStep::Crc(h, c);                                     \
+    i = CrcStep::Crc(i, d);                                     \
+    j = CrcStep::Crc(j, e);                                     \
     s += 40
 
     CHUNK(1, 1); CHUNK(k0, 0);
@@ -456,18 +473,28 @@ static void CityHashCrc256Long(const char *s, size_t len,
 }
 
 // Requires len < 240.
+template<typename CrcStep>
 static void CityHashCrc256Short(const char *s, size_t len, uint64_t *result) {
   char buf[240];
   memcpy(buf, s, len);
   memset(buf + len, 0, 240 - len);
-  CityHashCrc256Long(buf, 240, ~static_cast<uint32_t>(len), result);
+  CityHashCrc256Long<CrcStep>(buf, 240, ~static_cast<uint32_t>(len), result);
 }
 
-void CityHashCrc256(const char *s, size_t len, uint64_t *result) {
+template<typename CrcStep>
+static void CityHashCrc256Impl(const char *s, size_t len, uint64_t *result) {
   if (LIKELY(len >= 240)) {
-    CityHashCrc256Long(s, len, 0, result);
+    CityHashCrc256Long<CrcStep>(s, len, 0, result);
+  } else {
+    CityHashCrc256Short<CrcStep>(s, len, result);
+  }
+}
+
+void CityHashCrc256(const char *s, size_t len, uint64_t *result) {
+  if (detail::crc32c_hardware()) {
+    CityHashCrc256Impl<CrcHardware>(s, len, result);
   } else {
-    CityHashCrc256Short(s, len, result);
+    CityHashCrc256Impl<CrcSoftware>(s, len, result);
   }
 }
 
@@ -493,6 +520,10 @@ uint128 city_hash_crc_128(const char *s, size_t len) {
     return uint128(result[2], result[3]);
   }
 }
+
+uint64_t city_hash_crc_64(const char *s, size_t len) {
+  return Hash128to64(city_hash_crc_128(s, len));
+}
 } // namespace fc
 
 //#endif
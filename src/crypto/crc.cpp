@@ -601,27 +601,172 @@ static const uint32_t crc_c[256] = {
          0x79B737BA, 0x8BDCB4B9, 0x988C474D, 0x6AE7C44E,
          0xBE2DA0A5, 0x4C4623A6, 0x5F16D052, 0xAD7D5351,
  };
-#ifndef __SSE4_2__
 
+#include <fc/crypto/crc.hpp>
+#include <string.h>
 
-uint64_t _mm_crc32_u64(uint64_t a, uint64_t b )
-{
-    return crc32cSlicingBy8(a, (unsigned char*)&b, sizeof(b)); 
-}
-/*
-//#include "citycrc.h"
-#include <nmmintrin.h>
-#include <iostream>
+#if defined(__GNUC__) && defined(__x86_64__)
+#define FC_CRC32C_X86 1
+#include <cpuid.h>
+#endif
+
+namespace fc {
 
-int main( int argc, char** argv )
+namespace detail
 {
-    uint64_t f = 0x1234;
-    uint64_t a = 0x5678;
-    uint32_t f1 = _mm_crc32_u64(f, a); 
-    uint32_t f4  = crc32cSlicingBy8(f, (unsigned char*)&a, sizeof(a)); 
-    std::cout<<std::hex<<f1<<"\n"<<f2<<"\n"<<f3<<"\n"<<f4<<"\n";
-    return 0;
-}
-*/
+#ifdef FC_CRC32C_X86
+   // inline asm rather than the intrinsics so that the library does not
+   // have to be compiled with -msse4.2, the caller checks the cpu first
+   static inline uint64_t crc32c_hw_u64( uint64_t crc, uint64_t v )
+   {
+      __asm__( "crc32q %1, %0" : "+r"(crc) : "rm"(v) );
+      return crc;
+   }
+   static inline uint32_t crc32c_hw_u8( uint32_t crc, uint8_t v )
+   {
+      __asm__( "crc32b %1, %0" : "+r"(crc) : "rm"(v) );
+      return crc;
+   }
+
+   static uint32_t gf2_matrix_times( const uint32_t* mat, uint32_t vec )
+   {
+      uint32_t sum = 0;
+      for( ; vec; vec >>= 1, ++mat )
+         if( vec & 1 ) sum ^= *mat;
+      return sum;
+   }
+
+   static void gf2_matrix_square( uint32_t* square, const uint32_t* mat )
+   {
+      for( int n = 0; n < 32; ++n )
+         square[n] = gf2_matrix_times( mat, mat[n] );
+   }
+
+   /**
+    *  Tables that advance a crc over @param len zero bytes, used to join the
+    *  crcs of adjacent pieces: crc(a||b) = shift(crc(a)) ^ crc(b)
+    */
+   struct crc32c_shift_table
+   {
+      crc32c_shift_table( size_t len )
+      {
+         uint32_t odd[32], even[32];
+         odd[0] = 0x82f63b78;          // reflected polynomial, one zero bit
+         for( int n = 1; n < 32; ++n )
+            odd[n] = 1u << (n - 1);
+         gf2_matrix_square( even, odd ); // two zero bits
+         gf2_matrix_square( odd, even ); // four zero bits
+
+         // square up to len zero bytes, the first square below is one byte
+         const uint32_t* op = odd;
+         for( ;; )
+         {
+            gf2_matrix_square( even, odd );
+            len >>= 1;
+            if( len == 0 ) { op = even; break; }
+            gf2_matrix_square( odd, even );
+            len >>= 1;
+            if( len == 0 ) { op = odd; break; }
+         }
+         for( uint32_t n = 0; n < 256; ++n )
+         {
+            table[0][n] = gf2_matrix_times( op, n );
+            table[1][n] = gf2_matrix_times( op, n << 8 );
+            table[2][n] = gf2_matrix_times( op, n << 16 );
+            table[3][n] = gf2_matrix_times( op, n << 24 );
+         }
+      }
+
+      uint32_t shift( uint32_t crc )const
+      {
+         return table[0][crc & 0xff] ^ table[1][(crc >> 8) & 0xff] ^
+                table[2][(crc >> 16) & 0xff] ^ table[3][crc >> 24];
+      }
+
+      uint32_t table[4][256];
+   };
+
+   static const size_t crc32c_long  = 8192;
+   static const size_t crc32c_short = 256;
+
+   /**
+    *  crc32 has a latency of three cycles but can start every cycle, so
+    *  three independent streams are run over adjacent thirds of each
+    *  chunk and joined afterwards.
+    */
+   static uint32_t crc32c_hw( uint32_t crc, const char* p, size_t len )
+   {
+      static const crc32c_shift_table long_shift( crc32c_long );
+      static const crc32c_shift_table short_shift( crc32c_short );
+
+      uint64_t crc0 = crc;
+      while( len && (uintptr_t(p) & 7) )
+      {
+         crc0 = crc32c_hw_u8( uint32_t(crc0), uint8_t(*p++) );
+         --len;
+      }
+
+      while( len >= 3 * crc32c_long )
+      {
+         uint64_t crc1 = 0, crc2 = 0;
+         const char* end = p + crc32c_long;
+         do {
+            crc0 = crc32c_hw_u64( crc0, *(const uint64_t*)p );
+            crc1 = crc32c_hw_u64( crc1, *(const uint64_t*)(p + crc32c_long) );
+            crc2 = crc32c_hw_u64( crc2, *(const uint64_t*)(p + 2 * crc32c_long) );
+            p += 8;
+         } while( p < end );
+         crc0 = long_shift.shift( uint32_t(crc0) ) ^ uint32_t(crc1);
+         crc0 = long_shift.shift( uint32_t(crc0) ) ^ uint32_t(crc2);
+         p   += 2 * crc32c_long;
+         len -= 3 * crc32c_long;
+      }
+
+      while( len >= 3 * crc32c_short )
+      {
+         uint64_t crc1 = 0, crc2 = 0;
+         const char* end = p + crc32c_short;
+         do {
+            crc0 = crc32c_hw_u64( crc0, *(const uint64_t*)p );
+            crc1 = crc32c_hw_u64( crc1, *(const uint64_t*)(p + crc32c_short) );
+            crc2 = crc32c_hw_u64( crc2, *(const uint64_t*)(p + 2 * crc32c_short) );
+            p += 8;
+         } while( p < end );
+         crc0 = short_shift.shift( uint32_t(crc0) ) ^ uint32_t(crc1);
+         crc0 = short_shift.shift( uint32_t(crc0) ) ^ uint32_t(crc2);
+         p   += 2 * crc32c_short;
+         len -= 3 * crc32c_short;
+      }
+
+      for( ; len >= 8; len -= 8, p += 8 )
+         crc0 = crc32c_hw_u64( crc0, *(const uint64_t*)p );
+      for( ; len; --len )
+         crc0 = crc32c_hw_u8( uint32_t(crc0), uint8_t(*p++) );
+      return uint32_t(crc0);
+   }
+#endif
 
+   bool crc32c_hardware()
+   {
+#ifdef FC_CRC32C_X86
+      static const bool has_sse42 = []() {
+         unsigned int eax, ebx, ecx, edx;
+         return __get_cpuid( 1, &eax, &ebx, &ecx, &edx ) && (ecx & bit_SSE4_2);
+      }();
+      return has_sse42;
+#else
+      return false;
 #endif
+   }
+} // namespace detail
+
+   uint32_t crc32c( const char* data, size_t len, uint32_t crc )
+   {
+#ifdef FC_CRC32C_X86
+      if( detail::crc32c_hardware() )
+         return ~detail::crc32c_hw( ~crc, data, len );
+#endif
+      return ~crc32cSlicingBy8( ~crc, data, len );
+   }
+
+} // namespace fc
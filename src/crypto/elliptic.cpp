@@ -3,13 +3,22 @@
 #include <fc/exception/exception.hpp>
 #include <fc/log/logger.hpp>
 #include <fc/crypto/openssl.hpp>
+#include <fc/thread/worker_pool.hpp>
+#include <boost/thread/tss.hpp>
+#include <boost/atomic.hpp>
 #include <assert.h>
+#include <exception>
 
 namespace fc { namespace ecc {
     static int init = init_openssl();
 
     namespace detail 
     { 
+      /**
+       *  The EC_KEY of a public_key, decoded from its compressed form the
+       *  first time an operation needs the point.  Copies share the decoded
+       *  key by reference count.
+       */
       class public_key_impl
       {
         public:
@@ -19,16 +28,48 @@ namespace fc { namespace ecc {
           }
           ~public_key_impl()
           {
-            if( _key != nullptr )
-            {
-              EC_KEY_free(_key);
-            }
+            reset( nullptr );
           }
           public_key_impl( const public_key_impl& cpy )
+          :_key( cpy.share() )
           {
-            _key = cpy._key ? EC_KEY_dup( cpy._key ) : nullptr;
           }
-          EC_KEY* _key;
+
+          /** @return the decoded key of @param dat, or nullptr if dat is not a point on the curve */
+          EC_KEY* get( const public_key_data& dat )const;
+
+          EC_KEY* share()const
+          {
+            EC_KEY* k = _key.load( boost::memory_order_acquire );
+            if( k ) EC_KEY_up_ref( k );
+            return k;
+          }
+          EC_KEY* release()
+          {
+            return _key.exchange( nullptr, boost::memory_order_acq_rel );
+          }
+          /** takes ownership of @param k */
+          void reset( EC_KEY* k )
+          {
+            EC_KEY* old = _key.exchange( k, boost::memory_order_acq_rel );
+            if( old ) EC_KEY_free( old );
+          }
+
+          /** makes @param pk the public key of @param k, taking ownership of k */
+          static void attach( public_key& pk, EC_KEY* k )
+          {
+            EC_KEY_set_conv_form( k, POINT_CONVERSION_COMPRESSED );
+            unsigned char* front = (unsigned char*)pk._data.data;
+            if( i2o_ECPublicKey( k, &front ) != int(sizeof(pk._data)) )
+            {
+              EC_KEY_free( k );
+              FC_THROW_EXCEPTION( exception, "unable to serialize public key" );
+            }
+            pk.my->reset( k );
+          }
+
+        private:
+          mutable boost::atomic<EC_KEY*> _key;
       };
       class private_key_impl
       {
@@ -60,6 +101,69 @@ namespace fc { namespace ecc {
         return (void*)SHA512((const unsigned char*)input, ilen, (unsigned char*)output);
     }
 
+    /**
+     *  BN_CTX is only scratch space, so every thread keeps one for its lifetime
+     *  rather than allocating one per operation.  It is freed when the thread exits.
+     */
+    static BN_CTX* thread_bn_ctx()
+    {
+        static boost::thread_specific_ptr<BN_CTX> ctx( BN_CTX_free );
+        if( !ctx.get() ) ctx.reset( BN_CTX_new() );
+        return ctx.get();
+    }
+
+    namespace detail
+    {
+      /**
+       *  secp256k1 with the multiples of the generator precomputed.  It is built
+       *  once and every key gets a copy of it, which shares the tables, instead
+       *  of each key and operation constructing the curve from scratch.
+       */
+      static const EC_GROUP* secp256k1_group()
+      {
+         static EC_GROUP* group = []() -> EC_GROUP* {
+            EC_GROUP* g = EC_GROUP_new_by_curve_name( NID_secp256k1 );
+            if( g ) EC_GROUP_precompute_mult( g, thread_bn_ctx() );
+            return g;
+         }();
+         return group;
+      }
+
+      /** replaces detail::new_secp256k1_key() */
+      static EC_KEY* new_secp256k1_key()
+      {
+         EC_KEY* k = EC_KEY_new();
+         if( k && !EC_KEY_set_group( k, secp256k1_group() ) )
+         {
+            EC_KEY_free( k );
+            return nullptr;
+         }
+         return k;
+      }
+
+      EC_KEY* public_key_impl::get( const public_key_data& dat )const
+      {
+         EC_KEY* k = _key.load( boost::memory_order_acquire );
+         if( k || dat.data[0] == 0 ) return k;
+
+         k = new_secp256k1_key();
+         const unsigned char* front = (const unsigned char*)dat.data;
+         if( !k || !o2i_ECPublicKey( &k, &front, sizeof(dat) ) )
+         {
+            if( k ) EC_KEY_free( k );
+            return nullptr;
+         }
+         // another thread may have decoded the same key meanwhile
+         EC_KEY* expected = nullptr;
+         if( !_key.compare_exchange_strong( expected, k, boost::memory_order_acq_rel ) )
+         {
+            EC_KEY_free( k );
+            return expected;
+         }
+         return k;
+      }
+    }
+
     // Perform ECDSA key recovery (see SEC1 4.1.6) for curves over (mod p)-fields
     // recid selects which key is recovered
     // if check is non-zero, additional checks are performed
@@ -85,7 +189,7 @@ namespace fc { namespace ecc {
         int i = recid / 2;
 
         const EC_GROUP *group = EC_KEY_get0_group(eckey);
-        if ((ctx = BN_CTX_new()) == NULL) { ret = -1; goto err; }
+        if ((ctx = thread_bn_ctx()) == NULL) { ret = -1; goto err; }
         BN_CTX_start(ctx);
         order = BN_CTX_get(ctx);
         if (!EC_GROUP_get_order(group, order, ctx)) { ret = -2; goto err; }
@@ -126,7 +230,6 @@ namespace fc { namespace ecc {
     err:
         if (ctx) {
             BN_CTX_end(ctx);
-            BN_CTX_free(ctx);
         }
         if (R != NULL) EC_POINT_free(R);
         if (O != NULL) EC_POINT_free(O);
@@ -145,7 +248,7 @@ namespace fc { namespace ecc {
 
         const EC_GROUP *group = EC_KEY_get0_group(eckey);
 
-        if ((ctx = BN_CTX_new()) == NULL)
+        if ((ctx = thread_bn_ctx()) == NULL)
         goto err;
 
         pub_key = EC_POINT_new(group);
@@ -164,7 +267,6 @@ namespace fc { namespace ecc {
         err:
 
         if (pub_key) EC_POINT_free(pub_key);
-        if (ctx != NULL) BN_CTX_free(ctx);
 
         return(ok);
     }
@@ -188,8 +290,10 @@ namespace fc { namespace ecc {
     public_key public_key::mult( const fc::sha256& digest )
     {
         // get point from this public key
-        const EC_POINT* master_pub   = EC_KEY_get0_public_key( my->_key );
-        ec_group group(EC_GROUP_new_by_curve_name(NID_secp256k1));
+        EC_KEY* master = my->get( _data );
+        FC_ASSERT( master != nullptr, "invalid public key" );
+        const EC_POINT* master_pub   = EC_KEY_get0_public_key( master );
+        const EC_GROUP* group = detail::secp256k1_group();
 
         ssl_bignum z;
         BN_bin2bn((unsigned char*)&digest, sizeof(digest), z);
@@ -197,26 +301,28 @@ namespace fc { namespace ecc {
         // multiply by digest
         ssl_bignum one;
         BN_one(one);
-        bn_ctx ctx(BN_CTX_new());
+        BN_CTX* ctx = thread_bn_ctx();
 
         ec_point result(EC_POINT_new(group));
         EC_POINT_mul(group, result, z, master_pub, one, ctx);
 
         public_key rtn;
-        rtn.my->_key = EC_KEY_new_by_curve_name( NID_secp256k1 );
-        EC_KEY_set_public_key(rtn.my->_key,result);
+        EC_KEY* k = detail::new_secp256k1_key();
+        EC_KEY_set_public_key(k,result);
+        detail::public_key_impl::attach( rtn, k );
 
         return rtn;
     }
     bool       public_key::valid()const
     {
-      return my->_key != nullptr;
+      // the point is decoded at most once, later calls only load the cached key
+      return my->get( _data ) != nullptr;
     }
     public_key public_key::add( const fc::sha256& digest )const
     {
       try {
-        ec_group group(EC_GROUP_new_by_curve_name(NID_secp256k1));
-        bn_ctx ctx(BN_CTX_new());
+        const EC_GROUP* group = detail::secp256k1_group();
+        BN_CTX* ctx = thread_bn_ctx();
 
         fc::bigint digest_bi( (char*)&digest, sizeof(digest) );
 
@@ -229,10 +335,12 @@ namespace fc { namespace ecc {
 
 
         public_key digest_key = private_key::regenerate(digest).get_public_key();
-        const EC_POINT* digest_point   = EC_KEY_get0_public_key( digest_key.my->_key );
+        const EC_POINT* digest_point   = EC_KEY_get0_public_key( digest_key.my->get( digest_key._data ) );
 
         // get point from this public key
-        const EC_POINT* master_pub   = EC_KEY_get0_public_key( my->_key );
+        EC_KEY* master = my->get( _data );
+        FC_ASSERT( master != nullptr, "invalid public key" );
+        const EC_POINT* master_pub   = EC_KEY_get0_public_key( master );
 
         ssl_bignum z;
         BN_bin2bn((unsigned char*)&digest, sizeof(digest), z);
@@ -251,8 +359,9 @@ namespace fc { namespace ecc {
 
 
         public_key rtn;
-        rtn.my->_key = EC_KEY_new_by_curve_name( NID_secp256k1 );
-        EC_KEY_set_public_key(rtn.my->_key,result);
+        EC_KEY* k = detail::new_secp256k1_key();
+        EC_KEY_set_public_key(k,result);
+        detail::public_key_impl::attach( rtn, k );
         return rtn;
       } FC_RETHROW_EXCEPTIONS( debug, "digest: ${digest}", ("digest",digest) );
     }
@@ -265,8 +374,8 @@ namespace fc { namespace ecc {
         ssl_bignum z;
         BN_bin2bn((unsigned char*)&offset, sizeof(offset), z);
 
-        ec_group group(EC_GROUP_new_by_curve_name(NID_secp256k1));
-        bn_ctx ctx(BN_CTX_new());
+        const EC_GROUP* group = detail::secp256k1_group();
+        BN_CTX* ctx = thread_bn_ctx();
         ssl_bignum order;
         EC_GROUP_get_order(group, order, ctx);
 
@@ -286,7 +395,7 @@ namespace fc { namespace ecc {
     private_key private_key::regenerate( const fc::sha256& secret )
     {
        private_key self;
-       self.my->_key = EC_KEY_new_by_curve_name( NID_secp256k1 );
+       self.my->_key = detail::new_secp256k1_key();
        if( !self.my->_key ) FC_THROW_EXCEPTION( exception, "Unable to generate EC key" );
       
        ssl_bignum bn;
@@ -320,7 +429,7 @@ namespace fc { namespace ecc {
     private_key private_key::generate()
     {
        private_key self;
-       EC_KEY* k = EC_KEY_new_by_curve_name( NID_secp256k1 );
+       EC_KEY* k = detail::new_secp256k1_key();
        if( !k ) FC_THROW_EXCEPTION( exception, "Unable to generate EC key" );
        self.my->_key = k;
        if( !EC_KEY_generate_key( self.my->_key ) )
@@ -359,27 +468,13 @@ namespace fc { namespace ecc {
 
         return sig;
     }
-    bool       public_key::verify( const fc::sha256& digest, const fc::ecc::signature& sig )
+    bool       public_key::verify( const fc::sha256& digest, const fc::ecc::signature& sig )const
     {
-      return 1 == ECDSA_verify( 0, (unsigned char*)&digest, sizeof(digest), (unsigned char*)&sig, sizeof(sig), my->_key ); 
+      EC_KEY* k = my->get( _data );
+      if( !k ) return false;
+      return 1 == ECDSA_verify( 0, (unsigned char*)&digest, sizeof(digest), (unsigned char*)&sig, sizeof(sig), k ); 
     }
 
-    public_key_data public_key::serialize()const
-    {
-      public_key_data dat;
-      if( !my->_key ) return dat;
-      EC_KEY_set_conv_form( my->_key, POINT_CONVERSION_COMPRESSED );
-      /*size_t nbytes = */i2o_ECPublicKey( my->_key, nullptr );
-      /*assert( nbytes == 33 )*/
-      char* front = &dat.data[0];
-      i2o_ECPublicKey( my->_key, (unsigned char**)&front  );
-      return dat;
-      /*
-       EC_POINT* pub   = EC_KEY_get0_public_key( my->_key );
-       EC_GROUP* group = EC_KEY_get0_group( my->_key );
-       EC_POINT_get_affine_coordinates_GFp( group, pub, self.my->_pub_x.get(), self.my->_pub_y.get(), nullptr );
-       */
-    }
     public_key::public_key()
     {
     }
@@ -387,14 +482,12 @@ namespace fc { namespace ecc {
     {
     }
     public_key::public_key( const public_key_data& dat )
+    :_data(dat)
     {
-      const char* front = &dat.data[0];
-      my->_key = EC_KEY_new_by_curve_name( NID_secp256k1 );
-      my->_key = o2i_ECPublicKey( &my->_key, (const unsigned char**)&front, sizeof(public_key_data) );
-      if( !my->_key ) 
-      {
+      // the bytes may come from a peer, so they are checked to be a point on the
+      // curve here; the decoded key is cached for the operations that follow
+      if( !my->get( _data ) )
         FC_THROW_EXCEPTION( exception, "error decoding public key", ("s", ERR_error_string( ERR_get_error(), nullptr) ) );
-      }
     }
 
     bool       private_key::verify( const fc::sha256& digest, const fc::ecc::signature& sig )
@@ -406,8 +499,9 @@ namespace fc { namespace ecc {
     {
 
        public_key pub;  
-       pub.my->_key = EC_KEY_new_by_curve_name( NID_secp256k1 );
-       EC_KEY_set_public_key( pub.my->_key, EC_KEY_get0_public_key( my->_key ) );
+       EC_KEY* k = detail::new_secp256k1_key();
+       EC_KEY_set_public_key( k, EC_KEY_get0_public_key( my->_key ) );
+       detail::public_key_impl::attach( pub, k );
        return pub;
     }
 
@@ -415,9 +509,10 @@ namespace fc { namespace ecc {
     fc::sha512 private_key::get_shared_secret( const public_key& other )const
     {
       FC_ASSERT( my->_key != nullptr );
-      FC_ASSERT( other.my->_key != nullptr );
+      EC_KEY* other_key = other.my->get( other._data );
+      FC_ASSERT( other_key != nullptr );
       fc::sha512 buf;
-      ECDH_compute_key( (unsigned char*)&buf, sizeof(buf), EC_KEY_get0_public_key(other.my->_key), my->_key, ecies_key_derivation );
+      ECDH_compute_key( (unsigned char*)&buf, sizeof(buf), EC_KEY_get0_public_key(other_key), my->_key, ecies_key_derivation );
       return buf;
     }
 
@@ -435,20 +530,20 @@ namespace fc { namespace ecc {
         BN_bin2bn(&c.data[1],32,sig->r);
         BN_bin2bn(&c.data[33],32,sig->s);
 
-        my->_key = EC_KEY_new_by_curve_name(NID_secp256k1);
+        EC_KEY* k = detail::new_secp256k1_key();
 
         if (nV >= 31)
         {
-            EC_KEY_set_conv_form( my->_key, POINT_CONVERSION_COMPRESSED );
             nV -= 4;
-//            fprintf( stderr, "compressed\n" );
         }
 
-        if (ECDSA_SIG_recover_key_GFp(my->_key, sig, (unsigned char*)&digest, sizeof(digest), nV - 27, 0) == 1)
+        if (ECDSA_SIG_recover_key_GFp(k, sig, (unsigned char*)&digest, sizeof(digest), nV - 27, 0) == 1)
         {
             ECDSA_SIG_free(sig);
+            detail::public_key_impl::attach( *this, k );
             return;
         }
+        EC_KEY_free(k);
         ECDSA_SIG_free(sig);
         FC_THROW_EXCEPTION( exception, "unable to reconstruct public key from signature" );
     }
@@ -457,7 +552,6 @@ namespace fc { namespace ecc {
     {
        try {
         FC_ASSERT( my->_key != nullptr );
-        auto my_pub_key = get_public_key().serialize(); // just for good measure
         //ECDSA_SIG *sig = ECDSA_do_sign((unsigned char*)&digest, sizeof(digest), my->_key);
         ecdsa_sig sig = ECDSA_do_sign((unsigned char*)&digest, sizeof(digest), my->_key);
 
@@ -471,16 +565,15 @@ namespace fc { namespace ecc {
         int nBitsS = BN_num_bits(sig->s);
         if (nBitsR <= 256 && nBitsS <= 256)
         {
+            // compare points directly rather than serializing a key per candidate
+            const EC_POINT* my_point = EC_KEY_get0_public_key( my->_key );
+            ec_key keyRec( detail::new_secp256k1_key() );
             int nRecId = -1;
             for (int i=0; i<4; i++)
             {
-                public_key keyRec;
-                keyRec.my->_key = EC_KEY_new_by_curve_name( NID_secp256k1 );
-          //      keyRec.fSet = true;
-          //      if (fCompressedPubKey) keyRec.SetCompressedPubKey();
-                if (ECDSA_SIG_recover_key_GFp(keyRec.my->_key, sig, (unsigned char*)&digest, sizeof(digest), i, 1) == 1)
+                if (ECDSA_SIG_recover_key_GFp(keyRec, sig, (unsigned char*)&digest, sizeof(digest), i, 1) == 1)
                 {
-                    if (keyRec.serialize() == my_pub_key )
+                    if (0 == EC_POINT_cmp( detail::secp256k1_group(), EC_KEY_get0_public_key(keyRec), my_point, thread_bn_ctx() ) )
                     {
                        nRecId = i;
                        break;
@@ -526,12 +619,13 @@ namespace fc { namespace ecc {
      return *this;
    }
    public_key::public_key( const public_key& pk )
-   :my(pk.my)
+   :_data(pk._data),my(pk.my)
    {
    }
    public_key::public_key( public_key&& pk )
-   :my( fc::move( pk.my) )
+   :_data(pk._data)
    {
+     my->reset( pk.my->release() );
    }
    private_key::private_key( const private_key& pk )
    :my(pk.my)
@@ -544,21 +638,14 @@ namespace fc { namespace ecc {
 
    public_key& public_key::operator=( public_key&& pk )
    {
-     if( my->_key )
-     {
-       EC_KEY_free(my->_key);
-     }
-     my->_key = pk.my->_key;
-     pk.my->_key = nullptr;
+     _data = pk._data;
+     my->reset( pk.my->release() );
      return *this;
    }
    public_key& public_key::operator=( const public_key& pk )
    {
-     if( my->_key )
-     {
-       EC_KEY_free(my->_key);
-     }
-     my->_key = EC_KEY_dup(pk.my->_key);
+     _data = pk._data;
+     my->reset( pk.my->share() );
      return *this;
    }
    private_key& private_key::operator=( const private_key& pk )
@@ -571,6 +658,84 @@ namespace fc { namespace ecc {
      return *this;
    }
 
+   namespace detail
+   {
+      /** batches smaller than this are not worth handing to another thread */
+      static const size_t min_batch_chunk = 32;
+
+      /**
+       *  Calls @param f with consecutive [begin,end) ranges covering count items,
+       *  the first range on the calling thread and the rest on the pool.
+       */
+      template<typename Functor>
+      static void run_batch( size_t count, uint32_t threads, Functor&& f )
+      {
+         worker_pool& pool = worker_pool::instance();
+         if( threads == 0 || threads > pool.size() ) threads = uint32_t(pool.size());
+         size_t chunks = std::min<size_t>( threads, (count + min_batch_chunk - 1) / min_batch_chunk );
+         if( chunks <= 1 )
+         {
+            f( 0, count );
+            return;
+         }
+
+         size_t per_chunk = (count + chunks - 1) / chunks;
+         std::vector<fc::future<void>> pending;
+         std::exception_ptr error;
+         try {
+            for( size_t c = 1; c < chunks; ++c )
+            {
+               size_t begin = c * per_chunk;
+               size_t end   = std::min( count, begin + per_chunk );
+               if( begin >= end ) break;
+               pending.push_back( pool[c - 1].async( [&f,begin,end](){ f( begin, end ); }, "ecc::batch" ) );
+            }
+            f( 0, std::min( count, per_chunk ) );
+         } catch ( ... ) {
+            error = std::current_exception();
+         }
+         // the ranges refer to f and the caller's locals, so every one of them
+         // has to finish before the first error is passed on
+         for( auto itr = pending.begin(); itr != pending.end(); ++itr )
+         {
+            try {
+               itr->wait();
+            } catch ( ... ) {
+               if( !error ) error = std::current_exception();
+            }
+         }
+         if( error ) std::rethrow_exception( error );
+      }
+   }
+
+   std::vector<bool> verify_batch( const fc::sha256* digests, const signature* sigs, const public_key* keys,
+                                   size_t count, uint32_t threads )
+   {
+      // vector<bool> packs bits, so each thread writes its own bytes first
+      std::vector<char> valid( count );
+      detail::run_batch( count, threads, [&]( size_t begin, size_t end ) {
+         for( size_t i = begin; i < end; ++i )
+            valid[i] = keys[i].valid() && keys[i].verify( digests[i], sigs[i] );
+      });
+      return std::vector<bool>( valid.begin(), valid.end() );
+   }
+
+   std::vector<public_key> recover_batch( const fc::sha256* digests, const compact_signature* sigs,
+                                          size_t count, uint32_t threads )
+   {
+      std::vector<public_key> keys( count );
+      detail::run_batch( count, threads, [&]( size_t begin, size_t end ) {
+         for( size_t i = begin; i < end; ++i )
+         {
+            try {
+               keys[i] = public_key( sigs[i], digests[i] );
+            } catch ( const fc::exception& ) {
+            }
+         }
+      });
+      return keys;
+   }
+
 }
   void to_variant( const ecc::private_key& var,  variant& vo )
   {
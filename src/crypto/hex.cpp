@@ -1,8 +1,58 @@
 #include <fc/crypto/hex.hpp>
 #include <fc/exception/exception.hpp>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 namespace fc {
 
+    namespace detail
+    {
+       /** the two digits of every byte */
+       struct hex_table
+       {
+          hex_table()
+          {
+             const char* digits = "0123456789abcdef";
+             for( int i = 0; i < 256; ++i )
+             {
+                pairs[i][0] = digits[i >> 4];
+                pairs[i][1] = digits[i & 0x0f];
+             }
+          }
+          char pairs[256][2];
+       };
+       static const hex_table hex_digits;
+
+#if defined(__SSE2__)
+       /** the hex digits of 16 nibbles, '0' + n plus 'a'-'0'-10 where n > 9 */
+       static inline __m128i nibbles_to_hex( __m128i n )
+       {
+          __m128i letters = _mm_and_si128( _mm_cmpgt_epi8( n, _mm_set1_epi8( 9 ) ), _mm_set1_epi8( 'a' - '0' - 10 ) );
+          return _mm_add_epi8( _mm_add_epi8( n, _mm_set1_epi8( '0' ) ), letters );
+       }
+
+       /**
+        *  The values of 16 hex digits, @param valid gets a mask of the bytes
+        *  that were digits.
+        */
+       static inline __m128i hex_to_nibbles( __m128i c, int& valid )
+       {
+          const __m128i below_0 = _mm_set1_epi8( '0' - 1 );
+          __m128i digit = _mm_and_si128( _mm_cmpgt_epi8( c, below_0 ), _mm_cmplt_epi8( c, _mm_set1_epi8( '9' + 1 ) ) );
+          // folding to lower case maps 'A'-'F' onto 'a'-'f'
+          __m128i lower = _mm_or_si128( c, _mm_set1_epi8( 0x20 ) );
+          __m128i alpha = _mm_and_si128( _mm_cmpgt_epi8( lower, _mm_set1_epi8( 'a' - 1 ) ), _mm_cmplt_epi8( lower, _mm_set1_epi8( 'f' + 1 ) ) );
+          valid = _mm_movemask_epi8( _mm_or_si128( digit, alpha ) );
+
+          __m128i dv = _mm_and_si128( digit, _mm_sub_epi8( c, _mm_set1_epi8( '0' ) ) );
+          __m128i av = _mm_and_si128( alpha, _mm_sub_epi8( lower, _mm_set1_epi8( 'a' - 10 ) ) );
+          return _mm_or_si128( dv, av );
+       }
+#endif
+    }
+
     uint8_t from_hex( char c ) {
       if( c >= '0' && c <= '9' )
         return c - '0';
@@ -14,23 +64,57 @@ namespace fc {
       return 0;
     }
 
+    void to_hex( const char* d, size_t s, char* out ) {
+        const uint8_t* c = (const uint8_t*)d;
+        size_t i = 0;
+#if defined(__SSE2__)
+        const __m128i low_nibble = _mm_set1_epi8( 0x0f );
+        for( ; i + 16 <= s; i += 16, out += 32 )
+        {
+           __m128i v  = _mm_loadu_si128( (const __m128i*)(c + i) );
+           __m128i hi = detail::nibbles_to_hex( _mm_and_si128( _mm_srli_epi16( v, 4 ), low_nibble ) );
+           __m128i lo = detail::nibbles_to_hex( _mm_and_si128( v, low_nibble ) );
+           _mm_storeu_si128( (__m128i*)out,        _mm_unpacklo_epi8( hi, lo ) );
+           _mm_storeu_si128( (__m128i*)(out + 16), _mm_unpackhi_epi8( hi, lo ) );
+        }
+#endif
+        for( ; i < s; ++i, out += 2 )
+        {
+           out[0] = detail::hex_digits.pairs[c[i]][0];
+           out[1] = detail::hex_digits.pairs[c[i]][1];
+        }
+    }
+
     fc::string to_hex( const char* d, uint32_t s ) {
-        fc::string r;
-        const char* to_hex="0123456789abcdef";
-        uint8_t* c = (uint8_t*)d;
-        for( uint32_t i = 0; i < s; ++i )
-            (r += to_hex[(c[i]>>4)]) += to_hex[(c[i] &0x0f)];
+        fc::string r( size_t(s) * 2, '\0' );
+        if( s ) to_hex( d, s, &r[0] );
         return r;
     }
 
-    size_t from_hex( const fc::string& hex_str, char* out_data, size_t out_data_len ) {
-        fc::string::const_iterator i = hex_str.begin();
+    size_t from_hex( const char* hex, size_t hex_len, char* out_data, size_t out_data_len ) {
         uint8_t* out_pos = (uint8_t*)out_data;
         uint8_t* out_end = out_pos + out_data_len;
-        while( i != hex_str.end() && out_end != out_pos ) {
+        const char* i   = hex;
+        const char* end = hex + hex_len;
+#if defined(__SSE2__)
+        while( end - i >= 16 && out_end - out_pos >= 8 )
+        {
+           int valid = 0;
+           __m128i n = detail::hex_to_nibbles( _mm_loadu_si128( (const __m128i*)i ), valid );
+           // leave invalid input to the scalar loop, which reports the character
+           if( valid != 0xffff ) break;
+           // each 16 bit lane holds the high digit in its low byte
+           __m128i bytes = _mm_or_si128( _mm_slli_epi16( _mm_and_si128( n, _mm_set1_epi16( 0x00ff ) ), 4 ),
+                                         _mm_srli_epi16( n, 8 ) );
+           _mm_storel_epi64( (__m128i*)out_pos, _mm_packus_epi16( bytes, bytes ) );
+           i       += 16;
+           out_pos += 8;
+        }
+#endif
+        while( i != end && out_end != out_pos ) {
           *out_pos = from_hex( *i ) << 4;   
           ++i;
-          if( i != hex_str.end() )  {
+          if( i != end )  {
               *out_pos |= from_hex( *i );
               ++i;
           }
@@ -39,4 +123,8 @@ namespace fc {
         return out_pos - (uint8_t*)out_data;
     }
 
+    size_t from_hex( const fc::string& hex_str, char* out_data, size_t out_data_len ) {
+        return from_hex( hex_str.c_str(), hex_str.size(), out_data, out_data_len );
+    }
+
 }
@@ -0,0 +1,186 @@
+#include <fc/crypto/merkle.hpp>
+#include <fc/thread/worker_pool.hpp>
+#include <fc/exception/exception.hpp>
+#include <algorithm>
+#include <exception>
+
+namespace fc { namespace merkle {
+
+  namespace detail
+  {
+    /** levels with fewer parents than this are hashed on the calling thread */
+    static const size_t min_parallel_chunk = 4096;
+
+    /**
+     *  Hashes the @param count nodes at @param in into their (count+1)/2
+     *  parents at @param out.
+     */
+    static void hash_level( const sha256* in, size_t count, sha256* out, uint32_t threads )
+    {
+       size_t parents = (count + 1) / 2;
+
+       // adjacent nodes are already laid out as the 64 byte message of their parent
+       std::vector<const char*> data( parents );
+       std::vector<uint32_t>    sizes( parents, 2 * sizeof(sha256) );
+       for( size_t p = 0; p < parents; ++p )
+          data[p] = (const char*)&in[2*p];
+
+       sha256 last[2];
+       if( count % 2 )
+       {
+          last[0] = last[1] = in[count-1];
+          data[parents-1] = (const char*)last;
+       }
+
+       size_t chunks = (parents + min_parallel_chunk - 1) / min_parallel_chunk;
+       if( chunks > 1 )
+       {
+          size_t workers = worker_pool::instance().size();
+          if( threads == 0 || threads > workers ) threads = uint32_t(workers);
+          chunks = std::min<size_t>( chunks, threads );
+       }
+       if( chunks <= 1 )
+       {
+          sha256::hash_many( data.data(), sizes.data(), out, parents );
+          return;
+       }
+
+       // the calling thread hashes the first chunk, the pool the others
+       worker_pool& pool = worker_pool::instance();
+       size_t per_chunk = (parents + chunks - 1) / chunks;
+       std::vector<fc::future<void>> pending;
+       std::exception_ptr error;
+       try {
+          for( size_t c = 1; c < chunks; ++c )
+          {
+             size_t begin = c * per_chunk;
+             if( begin >= parents ) break;
+             size_t n = std::min( parents - begin, per_chunk );
+             const char* const* d = data.data() + begin;
+             const uint32_t*    s = sizes.data() + begin;
+             sha256*            o = out + begin;
+             pending.push_back( pool[c - 1].async( [=](){ sha256::hash_many( d, s, o, n ); }, "merkle::hash_level" ) );
+          }
+          sha256::hash_many( data.data(), sizes.data(), out, std::min( parents, per_chunk ) );
+       } catch ( ... ) {
+          error = std::current_exception();
+       }
+       // the chunks read data, sizes and last from this frame, so every one
+       // of them has to finish before the first error is passed on
+       for( auto itr = pending.begin(); itr != pending.end(); ++itr )
+       {
+          try {
+             itr->wait();
+          } catch ( ... ) {
+             if( !error ) error = std::current_exception();
+          }
+       }
+       if( error ) std::rethrow_exception( error );
+    }
+  } // namespace detail
+
+  sha256 hash_pair( const sha256& left, const sha256& right )
+  {
+     sha256 pair[2] = { left, right };
+     return sha256::hash( (const char*)pair, sizeof(pair) );
+  }
+
+  sha256 root( const sha256* leaves, size_t count, uint32_t threads )
+  {
+     if( count == 0 ) return sha256();
+     if( count == 1 ) return leaves[0];
+
+     // alternate between two buffers, chunks hashed in parallel must not
+     // overwrite nodes another chunk is still reading
+     std::vector<sha256> level( (count + 1) / 2 );
+     std::vector<sha256> above( (level.size() + 1) / 2 );
+     detail::hash_level( leaves, count, level.data(), threads );
+     count = level.size();
+     while( count > 1 )
+     {
+        detail::hash_level( level.data(), count, above.data(), threads );
+        count = (count + 1) / 2;
+        level.swap( above );
+     }
+     return level[0];
+  }
+
+  sha256 proof::compute_root( const sha256& leaf )const
+  {
+     sha256   node = leaf;
+     uint64_t pos  = index;
+     for( auto itr = path.begin(); itr != path.end(); ++itr, pos >>= 1 )
+        node = (pos & 1) ? hash_pair( *itr, node ) : hash_pair( node, *itr );
+     return node;
+  }
+
+  proof make_proof( const sha256* leaves, size_t count, uint64_t index )
+  {
+     FC_ASSERT( index < count, "leaf ${i} is not in a tree of ${n} leaves", ("i",index)("n",uint64_t(count)) );
+     return tree( std::vector<sha256>( leaves, leaves + count ) ).make_proof( index );
+  }
+
+  tree::tree( const std::vector<sha256>& leaves, uint32_t threads )
+  {
+     if( leaves.empty() ) return;
+     _levels.push_back( leaves );
+     while( _levels.back().size() > 1 )
+     {
+        const std::vector<sha256>& below = _levels.back();
+        std::vector<sha256> level( (below.size() + 1) / 2 );
+        detail::hash_level( below.data(), below.size(), level.data(), threads );
+        _levels.push_back( std::move(level) );
+     }
+  }
+
+  void tree::append( const sha256& leaf )
+  {
+     if( _levels.empty() )
+     {
+        _levels.push_back( std::vector<sha256>( 1, leaf ) );
+        return;
+     }
+
+     // only the nodes on the new leaf's path change
+     _levels[0].push_back( leaf );
+     size_t pos = _levels[0].size() - 1;
+     for( size_t l = 0; _levels[l].size() > 1; ++l, pos /= 2 )
+     {
+        if( l + 1 == _levels.size() ) _levels.push_back( std::vector<sha256>() );
+
+        const std::vector<sha256>& level = _levels[l];
+        size_t left   = pos & ~size_t(1);
+        sha256 parent = hash_pair( level[left], left + 1 < level.size() ? level[left+1] : level[left] );
+
+        std::vector<sha256>& above = _levels[l+1];
+        if( pos / 2 < above.size() ) above[pos/2] = parent;
+        else                         above.push_back( parent );
+     }
+  }
+
+  sha256 tree::root()const
+  {
+     return _levels.empty() ? sha256() : _levels.back()[0];
+  }
+
+  proof tree::make_proof( uint64_t index )const
+  {
+     FC_ASSERT( index < size(), "leaf ${i} is not in a tree of ${n} leaves", ("i",index)("n",uint64_t(size())) );
+     proof p;
+     p.index = index;
+     for( size_t l = 0; l + 1 < _levels.size(); ++l, index >>= 1 )
+     {
+        const std::vector<sha256>& level = _levels[l];
+        uint64_t sibling = index ^ 1;
+        p.path.push_back( sibling < level.size() ? level[sibling] : level[index] );
+     }
+     return p;
+  }
+
+  const std::vector<sha256>& tree::leaves()const
+  {
+     static const std::vector<sha256> none;
+     return _levels.empty() ? none : _levels[0];
+  }
+
+} } // fc::merkle
@@ -99,16 +99,11 @@ bool operator == ( const ripemd160& h1, const ripemd160& h2 ) {
   
   void to_variant( const ripemd160& bi, variant& v )
   {
-     v = std::vector<char>( (const char*)&bi, ((const char*)&bi) + sizeof(bi) );
+     v = blob{ std::vector<char>( (const char*)&bi, ((const char*)&bi) + sizeof(bi) ) };
   }
   void from_variant( const variant& v, ripemd160& bi )
   {
-    std::vector<char> ve = v.as< std::vector<char> >();
-    if( ve.size() )
-    {
-        memcpy(&bi, ve.data(), fc::min<size_t>(ve.size(),sizeof(bi)) );
-    }
-    else
+    if( !from_variant( v, (char*)&bi, sizeof(bi) ) )
         memset( &bi, char(0), sizeof(bi) );
   }
   
@@ -83,16 +83,11 @@ namespace fc {
   
   void to_variant( const sha224& bi, variant& v )
   {
-     v = std::vector<char>( (const char*)&bi, ((const char*)&bi) + sizeof(bi) );
+     v = blob{ std::vector<char>( (const char*)&bi, ((const char*)&bi) + sizeof(bi) ) };
   }
   void from_variant( const variant& v, sha224& bi )
   {
-    std::vector<char> ve = v.as< std::vector<char> >();
-    if( ve.size() )
-    {
-        memcpy(&bi, ve.data(), fc::min<size_t>(ve.size(),sizeof(bi)) );
-    }
-    else
+    if( !from_variant( v, (char*)&bi, sizeof(bi) ) )
         memset( &bi, char(0), sizeof(bi) );
   }
 }
@@ -0,0 +1,286 @@
+#include <fc/crypto/sha256.hpp>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FC_SHA256_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace fc {
+
+  namespace detail
+  {
+    static const uint32_t sha256_k[64] = {
+      0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+      0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+      0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+      0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+      0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+      0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+      0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+      0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+    };
+
+    static const uint32_t sha256_iv[8] = {
+      0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    /**
+     *  A message split into the blocks the compression function consumes, the
+     *  full blocks are read in place and only the padded tail is copied.
+     */
+    struct sha256_message
+    {
+       void init( const char* d, uint32_t len )
+       {
+          data        = (const unsigned char*)d;
+          full_blocks = len / 64;
+          next        = 0;
+
+          uint32_t rest = len % 64;
+          memset( tail, 0, sizeof(tail) );
+          memcpy( tail, data + full_blocks * 64, rest );
+          tail[rest] = 0x80;
+          tail_blocks = rest + 9 <= 64 ? 1 : 2;
+
+          uint64_t bits = uint64_t(len) * 8;
+          unsigned char* end = tail + tail_blocks * 64;
+          for( int i = 1; i <= 8; ++i, bits >>= 8 )
+             end[-i] = (unsigned char)bits;
+       }
+
+       uint32_t blocks()const { return full_blocks + tail_blocks; }
+
+       const unsigned char* block( uint32_t i )const
+       {
+          return i < full_blocks ? data + i * 64 : tail + (i - full_blocks) * 64;
+       }
+
+       const unsigned char* data;
+       uint32_t             full_blocks;
+       uint32_t             tail_blocks;
+       uint32_t             next;
+       unsigned char        tail[128];
+    };
+
+    static inline uint32_t load_be32( const unsigned char* p )
+    {
+       return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+    }
+
+    static inline void store_digest( sha256& out, const uint32_t* state )
+    {
+       unsigned char* o = (unsigned char*)out.data();
+       for( int i = 0; i < 8; ++i )
+       {
+          o[i*4]   = (unsigned char)(state[i] >> 24);
+          o[i*4+1] = (unsigned char)(state[i] >> 16);
+          o[i*4+2] = (unsigned char)(state[i] >> 8);
+          o[i*4+3] = (unsigned char)(state[i]);
+       }
+    }
+
+#ifdef FC_SHA256_X86
+
+    /**
+     *  Multi-buffer SHA-256: lane i of every vector belongs to a different
+     *  message, so one pass of the compression function advances N messages.
+     *  When a message finishes its lane is refilled with the next one.
+     *
+     *  Written with GCC vector extensions and always inlined into callers
+     *  compiled for AVX2 or AVX-512, which pick the vector width.
+     */
+    template<typename V, int N>
+    static inline __attribute__((always_inline))
+    void sha256_multi_buffer( const char* const* data, const uint32_t* sizes, sha256* out, size_t count )
+    {
+       sha256_message msgs[N];
+       size_t         index[N];
+       bool           active[N];
+       V              state[8];
+       unsigned char  idle_block[64] = {0};
+
+       for( int l = 0; l < N; ++l ) active[l] = false;
+
+       size_t pending = 0;
+       int    running = 0;
+       for( ;; )
+       {
+          for( int l = 0; l < N && pending < count; ++l )
+          {
+             if( active[l] ) continue;
+             msgs[l].init( data[pending], sizes[pending] );
+             index[l]  = pending++;
+             active[l] = true;
+             ++running;
+             for( int j = 0; j < 8; ++j ) state[j][l] = sha256_iv[j];
+          }
+          if( running == 0 ) break;
+
+          const unsigned char* blocks[N];
+          for( int l = 0; l < N; ++l )
+             blocks[l] = active[l] ? msgs[l].block( msgs[l].next ) : idle_block;
+
+          V w[16];
+          V a = state[0], b = state[1], c = state[2], d = state[3];
+          V e = state[4], f = state[5], g = state[6], h = state[7];
+          for( int t = 0; t < 64; ++t )
+          {
+             V wt;
+             if( t < 16 )
+             {
+                for( int l = 0; l < N; ++l )
+                   wt[l] = load_be32( blocks[l] + t * 4 );
+             }
+             else
+             {
+                V w15 = w[(t-15)&15], w2 = w[(t-2)&15];
+                V s0  = ((w15 >> 7) | (w15 << 25)) ^ ((w15 >> 18) | (w15 << 14)) ^ (w15 >> 3);
+                V s1  = ((w2 >> 17) | (w2 << 15)) ^ ((w2 >> 19) | (w2 << 13)) ^ (w2 >> 10);
+                wt = w[t&15] + s0 + w[(t-7)&15] + s1;
+             }
+             w[t&15] = wt;
+
+             V S1  = ((e >> 6) | (e << 26)) ^ ((e >> 11) | (e << 21)) ^ ((e >> 25) | (e << 7));
+             V ch  = (e & f) ^ (~e & g);
+             V t1  = h + S1 + ch + sha256_k[t] + wt;
+             V S0  = ((a >> 2) | (a << 30)) ^ ((a >> 13) | (a << 19)) ^ ((a >> 22) | (a << 10));
+             V maj = (a & b) ^ (a & c) ^ (b & c);
+             V t2  = S0 + maj;
+             h = g; g = f; f = e; e = d + t1;
+             d = c; c = b; b = a; a = t1 + t2;
+          }
+          state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+          state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+
+          for( int l = 0; l < N; ++l )
+          {
+             if( !active[l] || ++msgs[l].next < msgs[l].blocks() ) continue;
+             uint32_t s[8];
+             for( int j = 0; j < 8; ++j ) s[j] = state[j][l];
+             store_digest( out[index[l]], s );
+             active[l] = false;
+             --running;
+          }
+       }
+    }
+
+    typedef uint32_t sha256_v8  __attribute__((vector_size(32)));
+    typedef uint32_t sha256_v16 __attribute__((vector_size(64)));
+
+    __attribute__((target("avx2")))
+    static void sha256_many_avx2( const char* const* data, const uint32_t* sizes, sha256* out, size_t count )
+    {
+       sha256_multi_buffer<sha256_v8,8>( data, sizes, out, count );
+    }
+
+    __attribute__((target("avx512f")))
+    static void sha256_many_avx512( const char* const* data, const uint32_t* sizes, sha256* out, size_t count )
+    {
+       sha256_multi_buffer<sha256_v16,16>( data, sizes, out, count );
+    }
+
+    /** compresses one block with the SHA extensions */
+    __attribute__((target("sha,sse4.1")))
+    static void sha256_block_shani( uint32_t* state, const unsigned char* block )
+    {
+       const __m128i byte_swap = _mm_set_epi64x( 0x0c0d0e0f08090a0bull, 0x0405060700010203ull );
+
+       __m128i tmp    = _mm_loadu_si128( (const __m128i*)&state[0] );
+       __m128i state1 = _mm_loadu_si128( (const __m128i*)&state[4] );
+       tmp    = _mm_shuffle_epi32( tmp, 0xB1 );            // CDAB
+       state1 = _mm_shuffle_epi32( state1, 0x1B );         // EFGH
+       __m128i state0 = _mm_alignr_epi8( tmp, state1, 8 ); // ABEF
+       state1 = _mm_blend_epi16( state1, tmp, 0xF0 );      // CDGH
+
+       const __m128i abef = state0;
+       const __m128i cdgh = state1;
+
+       __m128i msg[4];
+       for( int i = 0; i < 16; ++i )
+       {
+          __m128i& m = msg[i&3];
+          if( i < 4 )
+             m = _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i*)(block + i * 16) ), byte_swap );
+          else
+             m = _mm_sha256msg2_epu32( _mm_add_epi32( _mm_sha256msg1_epu32( m, msg[(i+1)&3] ),
+                                                      _mm_alignr_epi8( msg[(i+3)&3], msg[(i+2)&3], 4 ) ),
+                                       msg[(i+3)&3] );
+
+          __m128i wk = _mm_add_epi32( m, _mm_loadu_si128( (const __m128i*)&sha256_k[i*4] ) );
+          state1 = _mm_sha256rnds2_epu32( state1, state0, wk );
+          state0 = _mm_sha256rnds2_epu32( state0, state1, _mm_shuffle_epi32( wk, 0x0E ) );
+       }
+
+       state0 = _mm_add_epi32( state0, abef );
+       state1 = _mm_add_epi32( state1, cdgh );
+
+       tmp    = _mm_shuffle_epi32( state0, 0x1B );         // FEBA
+       state1 = _mm_shuffle_epi32( state1, 0xB1 );         // DCHG
+       state0 = _mm_blend_epi16( tmp, state1, 0xF0 );      // DCBA
+       state1 = _mm_alignr_epi8( state1, tmp, 8 );         // HGFE
+       _mm_storeu_si128( (__m128i*)&state[0], state0 );
+       _mm_storeu_si128( (__m128i*)&state[4], state1 );
+    }
+
+    static void sha256_many_shani( const char* const* data, const uint32_t* sizes, sha256* out, size_t count )
+    {
+       sha256_message msg;
+       for( size_t i = 0; i < count; ++i )
+       {
+          msg.init( data[i], sizes[i] );
+          uint32_t state[8];
+          memcpy( state, sha256_iv, sizeof(state) );
+          for( uint32_t b = 0; b < msg.blocks(); ++b )
+             sha256_block_shani( state, msg.block( b ) );
+          store_digest( out[i], state );
+       }
+    }
+
+    static uint64_t read_xcr0()
+    {
+       uint32_t lo, hi;
+       __asm__ volatile( "xgetbv" : "=a"(lo), "=d"(hi) : "c"(0) );
+       return (uint64_t(hi) << 32) | lo;
+    }
+
+    typedef void (*sha256_many_func)( const char* const*, const uint32_t*, sha256*, size_t );
+
+    /** picks the fastest implementation the cpu and os support */
+    static sha256_many_func select_sha256_many()
+    {
+       unsigned int eax, ebx, ecx, edx;
+       if( !__get_cpuid( 1, &eax, &ebx, &ecx, &edx ) ) return nullptr;
+       bool     osxsave = (ecx & bit_OSXSAVE) != 0;
+       uint64_t xcr0    = osxsave ? read_xcr0() : 0;
+
+       if( __get_cpuid_max( 0, nullptr ) < 7 ) return nullptr;
+       __cpuid_count( 7, 0, eax, ebx, ecx, edx );
+       bool has_sha    = (ebx & (1u << 29)) != 0;
+       bool has_avx2   = (ebx & (1u << 5))  != 0 && (xcr0 & 0x06) == 0x06;
+       bool has_avx512 = (ebx & (1u << 16)) != 0 && (xcr0 & 0xe6) == 0xe6;
+
+       if( has_avx512 ) return sha256_many_avx512;
+       if( has_sha )    return sha256_many_shani;
+       if( has_avx2 )   return sha256_many_avx2;
+       return nullptr;
+    }
+#endif
+  } // namespace detail
+
+  void sha256::hash_many( const char* const* data, const uint32_t* sizes, sha256* out, size_t count )
+  {
+#ifdef FC_SHA256_X86
+     static const detail::sha256_many_func impl = detail::select_sha256_many();
+     if( impl )
+     {
+        impl( data, sizes, out, count );
+        return;
+     }
+#endif
+     for( size_t i = 0; i < count; ++i )
+        out[i] = hash( data[i], sizes[i] );
+  }
+
+} // namespace fc
@@ -1,7 +1,8 @@
 #include <fc/io/buffered_iostream.hpp>
 #include <fc/exception/exception.hpp>
-#include <boost/asio/streambuf.hpp>
-#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <string.h>
 
 #include <fc/log/logger.hpp>
 
@@ -9,20 +10,112 @@ namespace fc
 {
     namespace detail
     {
-       class buffered_istream_impl
+       /**
+        *  Fixed capacity storage that is read at the front and written at the
+        *  back.  Both ends wrap around, so the readable bytes and the free space
+        *  are each at most two contiguous pieces.
+        */
+       class ring_buffer
        {
           public:
-             buffered_istream_impl( istream_ptr is )
-             :_istr(fc::move(is)){}
+             ring_buffer( size_t capacity )
+             :_data(capacity),_begin(0),_size(0)
+             {
+                FC_ASSERT( capacity > 0, "a buffered stream needs a buffer" );
+             }
+
+             size_t capacity()const { return _data.size(); }
+             size_t size()const     { return _size; }
+             size_t space()const    { return _data.size() - _size; }
+             char   front()const    { return _data[_begin]; }
+
+             /** the first contiguous piece of the readable bytes */
+             const char* read_ptr( size_t& len )const
+             {
+                len = std::min( _size, _data.size() - _begin );
+                return _data.data() + _begin;
+             }
+
+             void consume( size_t len )
+             {
+                _begin += len;
+                _size  -= len;
+                if( _begin >= _data.size() ) _begin -= _data.size();
+                // an empty buffer starts over to keep the free space in one piece
+                if( _size == 0 ) _begin = 0;
+             }
+
+             /** the first contiguous piece of the free space */
+             char* write_ptr( size_t& len )
+             {
+                size_t end = _begin + _size;
+                if( end >= _data.size() ) end -= _data.size();
+                len = std::min( space(), _data.size() - end );
+                return _data.data() + end;
+             }
+
+             void commit( size_t len ) { _size += len; }
+
+             size_t read( char* buf, size_t len )
+             {
+                size_t total = 0;
+                while( total < len && _size )
+                {
+                   size_t      n;
+                   const char* p = read_ptr( n );
+                   n = std::min( n, len - total );
+                   memcpy( buf + total, p, n );
+                   consume( n );
+                   total += n;
+                }
+                return total;
+             }
+
+             size_t write( const char* buf, size_t len )
+             {
+                size_t total = 0;
+                while( total < len && space() )
+                {
+                   size_t n;
+                   char*  p = write_ptr( n );
+                   n = std::min( n, len - total );
+                   memcpy( p, buf + total, n );
+                   commit( n );
+                   total += n;
+                }
+                return total;
+             }
+
+          private:
+             std::vector<char> _data;
+             size_t            _begin;
+             size_t            _size;
+       };
 
-             istream_ptr            _istr;
-             boost::asio::streambuf _rdbuf;
+       class buffered_istream_impl
+       {
+          public:
+             buffered_istream_impl( istream_ptr is, size_t bufsize )
+             :_istr(fc::move(is)),_rdbuf(bufsize){}
+
+             /** reads from the stream straight into the buffer, which must be empty */
+             void fill()
+             {
+                size_t len;
+                char*  p = _rdbuf.write_ptr( len );
+                _rdbuf.commit( _istr->readsome( p, len ) );
+                if( !_rdbuf.size() )
+                   FC_THROW_EXCEPTION( assert_exception,
+                      "at least one byte should be available, or eof should have been thrown" );
+             }
+
+             istream_ptr _istr;
+             ring_buffer _rdbuf;
        };
-       static const size_t minimum_read_size = 1024;
     }
 
-    buffered_istream::buffered_istream( istream_ptr is )
-    :my( new detail::buffered_istream_impl( fc::move(is) ) )
+    buffered_istream::buffered_istream( istream_ptr is, size_t bufsize )
+    :my( new detail::buffered_istream_impl( fc::move(is), bufsize ) )
     {
        FC_ASSERT( my->_istr != nullptr, " this shouldn't be null" );
     }
@@ -40,47 +133,45 @@ namespace fc
 
     size_t buffered_istream::readsome( char* buf, size_t len )
     {
-        size_t bytes_from_rdbuf = static_cast<size_t>(my->_rdbuf.sgetn(buf, len));
-        if (bytes_from_rdbuf)
-           return bytes_from_rdbuf;
-
-
-        if( len > detail::minimum_read_size ) 
-           return my->_istr->readsome(buf,len);
+        if( my->_rdbuf.size() )
+           return my->_rdbuf.read( buf, len );
 
-        char tmp[detail::minimum_read_size];
-        size_t bytes_read = my->_istr->readsome( tmp, detail::minimum_read_size );
+        // nothing is gained by going through the buffer
+        if( len >= my->_rdbuf.capacity() )
+           return my->_istr->readsome( buf, len );
 
-        size_t bytes_to_deliver_immediately = std::min<size_t>(bytes_read,len);
-
-        memcpy( buf, tmp, bytes_to_deliver_immediately );
-        
-
-        if( bytes_read > len )
-        {
-           my->_rdbuf.sputn( tmp + len, bytes_read - len );
-        }
-
-        return bytes_to_deliver_immediately;
+        my->fill();
+        return my->_rdbuf.read( buf, len );
     }
 
     char  buffered_istream::peek()const
     {
-       if( my->_rdbuf.size() )
-       {
-          return my->_rdbuf.sgetc();
-       }
+       if( !my->_rdbuf.size() )
+          my->fill();
+       return my->_rdbuf.front();
+    }
 
-       char tmp[detail::minimum_read_size];
-       size_t bytes_read = my->_istr->readsome( tmp, detail::minimum_read_size );
-       my->_rdbuf.sputn( tmp, bytes_read );
+    char  buffered_istream::get()
+    {
+       if( !my->_rdbuf.size() )
+          my->fill();
+       char c = my->_rdbuf.front();
+       my->_rdbuf.consume( 1 );
+       return c;
+    }
 
-       if( my->_rdbuf.size() )
-       {
-          return my->_rdbuf.sgetc();
-       }
-       FC_THROW_EXCEPTION( assert_exception, 
-          "at least one byte should be available, or eof should have been thrown" );
+    const char* buffered_istream::data( size_t& len )
+    {
+       if( !my->_rdbuf.size() )
+          my->fill();
+       return my->_rdbuf.read_ptr( len );
+    }
+
+    void buffered_istream::consume( size_t len )
+    {
+       FC_ASSERT( len <= my->_rdbuf.size(), "consumed ${len} of ${size} buffered bytes",
+                  ("len",uint64_t(len))("size",uint64_t(my->_rdbuf.size())) );
+       my->_rdbuf.consume( len );
     }
 
 
@@ -89,16 +180,27 @@ namespace fc
        class buffered_ostream_impl
        {
           public:
-             buffered_ostream_impl( ostream_ptr os )
-             :_ostr(fc::move(os)){}
-
-             ostream_ptr            _ostr;
-             boost::asio::streambuf _rdbuf;
+             buffered_ostream_impl( ostream_ptr os, size_t bufsize )
+             :_ostr(fc::move(os)),_wrbuf(bufsize){}
+
+             /** writes the buffer to the stream straight from its storage */
+             void drain()
+             {
+                while( _wrbuf.size() )
+                {
+                   size_t      len;
+                   const char* p = _wrbuf.read_ptr( len );
+                   _wrbuf.consume( _ostr->writesome( p, len ) );
+                }
+             }
+
+             ostream_ptr _ostr;
+             ring_buffer _wrbuf;
        };
     }
 
     buffered_ostream::buffered_ostream( ostream_ptr os, size_t bufsize )
-    :my( new detail::buffered_ostream_impl( fc::move(os) ) )
+    :my( new detail::buffered_ostream_impl( fc::move(os), bufsize ) )
     {
     }
 
@@ -115,16 +217,31 @@ namespace fc
 
     size_t buffered_ostream::writesome( const char* buf, size_t len )
     {
-        size_t written = static_cast<size_t>(my->_rdbuf.sputn( buf, len ));
-        if( written < len ) { flush(); }
-        return written + static_cast<size_t>(my->_rdbuf.sputn( buf+written, len-written ));
+        if( !my->_wrbuf.size() && len >= my->_wrbuf.capacity() )
+           return my->_ostr->writesome( buf, len );
+
+        if( !my->_wrbuf.space() )
+           my->drain();
+        return my->_wrbuf.write( buf, len );
+    }
+
+    char* buffered_ostream::prepare( size_t& len )
+    {
+        if( !my->_wrbuf.space() )
+           my->drain();
+        return my->_wrbuf.write_ptr( len );
+    }
+
+    void buffered_ostream::commit( size_t len )
+    {
+        FC_ASSERT( len <= my->_wrbuf.space(), "committed ${len} bytes to ${space} bytes of free space",
+                   ("len",uint64_t(len))("space",uint64_t(my->_wrbuf.space())) );
+        my->_wrbuf.commit( len );
     }
 
     void  buffered_ostream::flush()
     {
-        char buffer[2048];    
-        while( size_t bytes_from_rdbuf = static_cast<size_t>(my->_rdbuf.sgetn(buffer,sizeof(buffer))) )
-           my->_ostr->write( buffer, bytes_from_rdbuf );
+        my->drain();
         my->_ostr->flush();
     }
 
@@ -5,6 +5,7 @@
 #include <fc/io/fstream.hpp>
 #include <fc/io/sstream.hpp>
 #include <fc/log/logger.hpp>
+#include <fc/crypto/hex.hpp>
 //#include <utfcpp/utf8.h>
 
 namespace fc
@@ -60,6 +61,24 @@ namespace fc
        }
    }
 
+   /**
+    *  Appends the characters up to the next quote or escape to @param token
+    *  in one piece.  @return false if the next character is not one of them.
+    */
+   template<typename T>
+   bool plainFromStream( T& in, fc::stringstream& token ) { return false; }
+   bool plainFromStream( buffered_istream& in, fc::stringstream& token )
+   {
+      size_t      len;
+      const char* begin = in.data( len );
+      const char* end   = begin;
+      while( end != begin + len && *end != '"' && *end != '\\' ) ++end;
+      if( end == begin ) return false;
+      token.write( begin, end - begin );
+      in.consume( end - begin );
+      return true;
+   }
+
    template<typename T>
    fc::string stringFromStream( T& in )
    {
@@ -75,7 +94,8 @@ namespace fc
          in.get();
          while( true )
          {
-            
+            if( plainFromStream( in, token ) )
+               continue;
             switch( c = in.peek() )
             {
                case '\\':
@@ -435,6 +455,15 @@ namespace fc
               to_stream(os, o );
               return;
            }
+         case variant::blob_type:
+           {
+              // hex digits never need escaping
+              const std::vector<char>& b = v.get_blob().data;
+              os << '"';
+              if( b.size() ) os << to_hex( b.data(), b.size() );
+              os << '"';
+              return;
+           }
       }
    }
 
@@ -7,6 +7,8 @@
 #include <fc/thread/scoped_lock.hpp>
 #include <fc/log/console_appender.hpp>
 #include <fc/log/file_appender.hpp>
+#include <fc/log/async_appender.hpp>
+#include <fc/log/binary_appender.hpp>
 #include <fc/variant.hpp>
 #include "console_defines.h"
 
@@ -42,7 +44,14 @@ namespace fc {
       get_appender_map()[name] = ap;
       return ap;
    }
+
+   void appender::log_batch( const log_message* msgs, size_t count )
+   {
+      for( size_t i = 0; i < count; ++i ) log( msgs[i] );
+   }
    
    static bool reg_console_appender = appender::register_appender<console_appender>( "console" );
    static bool reg_file_appender = appender::register_appender<file_appender>( "file" );
+   static bool reg_async_appender = appender::register_appender<async_appender>( "async" );
+   static bool reg_binary_appender = appender::register_appender<binary_appender>( "binary" );
 } // namespace fc
@@ -0,0 +1,287 @@
+#include <fc/log/async_appender.hpp>
+#include <fc/log/log_message.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/optional.hpp>
+#include <fc/variant.hpp>
+#include <fc/reflect/variant.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/tss.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/atomic.hpp>
+#include <boost/memory_order.hpp>
+#include <algorithm>
+
+namespace fc
+{
+   namespace detail
+   {
+      static const size_t cache_line_size = 64;
+
+      /**
+       *  A bounded ring of messages with exactly one producer (the thread
+       *  that owns it) and one consumer (the writer thread).
+       */
+      class async_log_queue
+      {
+         public:
+            async_log_queue( uint32_t size )
+            :_retired(false),_head(0),_tail(0)
+            {
+               uint64_t cap = 1;
+               while( cap < size ) cap <<= 1;
+               _mask = cap - 1;
+               _slots.resize( cap );
+            }
+
+            /** @return false if the queue is full */
+            bool push( const log_message& m )
+            {
+               uint64_t h = _head.load( boost::memory_order_relaxed );
+               if( h - _tail.load( boost::memory_order_acquire ) >= _slots.size() )
+                  return false;
+               _slots[ h & _mask ] = m;
+               _head.store( h + 1, boost::memory_order_release );
+               return true;
+            }
+
+            /** moves up to max messages to the end of out */
+            size_t pop( std::vector<log_message>& out, size_t max )
+            {
+               uint64_t t = _tail.load( boost::memory_order_relaxed );
+               uint64_t n = std::min<uint64_t>( _head.load( boost::memory_order_acquire ) - t, max );
+               for( uint64_t i = t; i < t + n; ++i )
+               {
+                  fc::optional<log_message>& slot = _slots[ i & _mask ];
+                  out.push_back( *slot );
+                  slot.reset();
+               }
+               _tail.store( t + n, boost::memory_order_release );
+               return n;
+            }
+
+            bool empty()const
+            {
+               return _head.load( boost::memory_order_acquire ) == _tail.load( boost::memory_order_relaxed );
+            }
+
+            /** called by the producer when its thread exits, it never pushes again */
+            void retire() { _retired.store( true, boost::memory_order_release ); }
+
+            /** @return true once the producer has exited and everything it pushed was popped */
+            bool finished()const
+            {
+               return _retired.load( boost::memory_order_acquire ) && empty();
+            }
+
+         private:
+            std::vector<fc::optional<log_message>> _slots;
+            uint64_t                               _mask;
+            boost::atomic<bool>                    _retired;
+
+            char                                   _pad0[cache_line_size];
+            boost::atomic<uint64_t>                _head;
+            char                                   _pad1[cache_line_size - sizeof(boost::atomic<uint64_t>)];
+            boost::atomic<uint64_t>                _tail;
+            char                                   _pad2[cache_line_size - sizeof(boost::atomic<uint64_t>)];
+      };
+
+      /**
+       *  The queues owned by the current thread, keyed by async_appender id.
+       *  The appenders own the queues, so entries of destroyed appenders expire.
+       */
+      struct thread_log_queues
+      {
+         struct entry
+         {
+            uint64_t                       id;
+            async_log_queue*               queue;
+            std::weak_ptr<async_log_queue> owner;
+         };
+
+         /** lets the writers free the queues once they are drained */
+         ~thread_log_queues()
+         {
+            for( auto itr = queues.begin(); itr != queues.end(); ++itr )
+               if( auto q = itr->owner.lock() ) q->retire();
+         }
+
+         /** forgets the queues of appenders that no longer exist */
+         void prune()
+         {
+            queues.erase( std::remove_if( queues.begin(), queues.end(),
+                                          []( const entry& e ) { return e.owner.expired(); } ),
+                          queues.end() );
+         }
+
+         std::vector<entry> queues;
+      };
+
+      /** deleted when the thread exits, which retires its queues */
+      static thread_log_queues& current_log_queues()
+      {
+         static boost::thread_specific_ptr<thread_log_queues> q;
+         if( !q.get() ) q.reset( new thread_log_queues() );
+         return *q;
+      }
+
+      static boost::atomic<uint64_t> next_async_appender_id(0);
+   }
+
+   class async_appender::impl : public fc::retainable
+   {
+      public:
+         impl( const config& c )
+         :cfg(c),id(detail::next_async_appender_id++),next_queue(0),
+          writer_sleeping(false),done(false),dropped(0){}
+
+         config                                               cfg;
+         std::vector<appender::ptr>                           targets;
+         uint64_t                                             id;
+
+         boost::mutex                                         queues_mutex;
+         std::vector< std::shared_ptr<detail::async_log_queue> > queues;
+         size_t                                               next_queue;
+
+         boost::mutex                                         wake_mutex;
+         boost::condition_variable                            wake;
+         boost::atomic<bool>                                  writer_sleeping;
+         boost::atomic<bool>                                  done;
+         boost::atomic<uint64_t>                              dropped;
+         boost::thread                                        writer;
+
+         /**
+          *  The queue stays in queues until the thread exits, so while this
+          *  appender is logging the raw pointer in the thread's entry is valid.
+          */
+         detail::async_log_queue& queue_for_current_thread()
+         {
+            auto& tq = detail::current_log_queues();
+            for( auto itr = tq.queues.begin(); itr != tq.queues.end(); ++itr )
+               if( itr->id == id ) return *itr->queue;
+
+            tq.prune();
+            auto q = std::make_shared<detail::async_log_queue>( cfg.queue_size );
+            {
+               boost::unique_lock<boost::mutex> lock(queues_mutex);
+               queues.push_back( q );
+            }
+            detail::thread_log_queues::entry e = { id, q.get(), q };
+            tq.queues.push_back( e );
+            return *q;
+         }
+
+         void wake_writer()
+         {
+            boost::unique_lock<boost::mutex> lock(wake_mutex);
+            wake.notify_one();
+         }
+
+         bool pending()
+         {
+            boost::unique_lock<boost::mutex> lock(queues_mutex);
+            for( auto itr = queues.begin(); itr != queues.end(); ++itr )
+               if( !(*itr)->empty() ) return true;
+            return false;
+         }
+
+         /**
+          *  Round robin over the thread queues until max_batch messages are
+          *  collected, dropping the queues of threads that have exited.
+          */
+         size_t drain( std::vector<log_message>& batch )
+         {
+            boost::unique_lock<boost::mutex> lock(queues_mutex);
+            queues.erase( std::remove_if( queues.begin(), queues.end(),
+                             []( const std::shared_ptr<detail::async_log_queue>& q ) { return q->finished(); } ),
+                          queues.end() );
+            for( size_t i = 0; i < queues.size() && batch.size() < cfg.max_batch; ++i )
+            {
+               next_queue = (next_queue + 1) % queues.size();
+               queues[next_queue]->pop( batch, cfg.max_batch - batch.size() );
+            }
+            return batch.size();
+         }
+
+         void write( std::vector<log_message>& batch )
+         {
+            // messages from a single thread are already in order, this interleaves the threads
+            std::stable_sort( batch.begin(), batch.end(), []( const log_message& a, const log_message& b ) {
+               return a.get_context().get_timestamp() < b.get_context().get_timestamp();
+            });
+            for( auto itr = targets.begin(); itr != targets.end(); ++itr )
+            {
+               try { (*itr)->log_batch( batch.data(), batch.size() ); } catch ( ... ) {}
+            }
+            batch.clear();
+         }
+
+         void run()
+         {
+            std::vector<log_message> batch;
+            batch.reserve( cfg.max_batch );
+            while( true )
+            {
+               if( drain( batch ) )
+               {
+                  write( batch );
+                  continue;
+               }
+
+               uint64_t lost = dropped.exchange( 0 );
+               if( lost )
+               {
+                  batch.push_back( FC_LOG_MESSAGE( warn, "async appender dropped ${count} messages", ("count",lost) ) );
+                  write( batch );
+               }
+
+               if( done.load() ) return;
+
+               boost::unique_lock<boost::mutex> lock(wake_mutex);
+               writer_sleeping.store( true );
+               boost::atomic_thread_fence( boost::memory_order_seq_cst );
+               if( !pending() && !done.load() )
+                  wake.timed_wait( lock, boost::posix_time::milliseconds(100) );
+               writer_sleeping.store( false );
+            }
+         }
+   };
+
+   async_appender::async_appender( const variant& args )
+   :my( new impl( args.as<config>() ) )
+   {
+      for( auto itr = my->cfg.appenders.begin(); itr != my->cfg.appenders.end(); ++itr )
+      {
+         auto ap = appender::get( *itr );
+         if( ap ) my->targets.push_back( ap );
+      }
+      impl* self = my.get();
+      my->writer = boost::thread( [self](){ self->run(); } );
+   }
+
+   async_appender::~async_appender()
+   {
+      my->done.store( true );
+      my->wake_writer();
+      my->writer.join();
+   }
+
+   void async_appender::log( const log_message& m )
+   {
+      detail::async_log_queue& q = my->queue_for_current_thread();
+      while( !q.push( m ) )
+      {
+         if( my->cfg.overflow == overflow_policy::drop )
+         {
+            ++my->dropped;
+            return;
+         }
+         my->wake_writer();
+         fc::usleep( fc::microseconds(100) );
+      }
+      boost::atomic_thread_fence( boost::memory_order_seq_cst );
+      if( my->writer_sleeping.load( boost::memory_order_relaxed ) )
+         my->wake_writer();
+   }
+
+} // namespace fc
@@ -0,0 +1,426 @@
+#include <fc/log/binary_appender.hpp>
+#include <fc/interprocess/file_mapping.hpp>
+#include <fc/io/datastream.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/io/raw_variant.hpp>
+#include <fc/io/fstream.hpp>
+#include <fc/thread/scoped_lock.hpp>
+#include <fc/exception/exception.hpp>
+#include <fc/variant.hpp>
+#include <fc/reflect/variant.hpp>
+#include <boost/thread/mutex.hpp>
+#include <unordered_map>
+#include <algorithm>
+#include <memory>
+#include <string.h>
+
+namespace fc { namespace detail {
+
+   static const uint64_t binary_log_magic   = 0x31474f4c4e494246ull; // "FBINLOG1"
+   static const uint32_t binary_log_version = 1;
+
+   /** stored at the start of every segment */
+   struct binary_log_header
+   {
+      uint64_t magic;
+      uint32_t version;
+      uint32_t reserved;
+      /** increases every time a segment is started, orders the segments */
+      uint64_t sequence;
+      /** bytes of the segment in use, including this header */
+      uint64_t used;
+   };
+
+   struct binary_log_site
+   {
+      uint32_t    id;
+      int32_t     level;
+      string      file;
+      uint64_t    line;
+      string      method;
+      string      format;
+   };
+
+   struct binary_log_record
+   {
+      uint32_t       site;
+      int64_t        timestamp;
+      string         thread_name;
+      string         context;
+      variant_object scope;
+      // followed by the arguments, packed as a variant_object
+   };
+
+   /** a message record, packs the captured arguments without building a variant_object */
+   struct binary_log_message
+   {
+      const binary_log_record* rec;
+      const log_message*       msg;
+   };
+
+   /** every record is prefixed by its type and packed size */
+   enum binary_log_record_type { site_record = 1, message_record = 2 };
+   static const size_t record_prefix_size = sizeof(uint8_t) + sizeof(uint32_t);
+} } // fc::detail
+
+FC_REFLECT( fc::detail::binary_log_site, (id)(level)(file)(line)(method)(format) )
+FC_REFLECT( fc::detail::binary_log_record, (site)(timestamp)(thread_name)(context)(scope) )
+
+namespace fc { namespace raw {
+
+   template<typename Stream>
+   inline void pack( Stream& s, const fc::detail::binary_log_message& m )
+   {
+      fc::raw::pack( s, *m.rec );
+      const log_args* args = m.msg->get_args();
+      if( !args )
+      {
+         fc::raw::pack( s, m.msg->get_data() );
+         return;
+      }
+
+      // the same bytes as packing args->to_variant_object(), duplicate keys
+      // are resolved by the reader just like mutable_variant_object::set
+      uint32_t      count = 0;
+      size_t        pos   = 0;
+      log_args::arg a;
+      while( args->next( pos, a ) ) ++count;
+      fc::raw::pack( s, unsigned_int( count ) );
+
+      pos = 0;
+      while( args->next( pos, a ) )
+      {
+         fc::raw::pack( s, unsigned_int( uint32_t(a.key_size) ) );
+         s.write( a.key, a.key_size );
+         switch( a.type )
+         {
+            case log_args::int_arg:
+               fc::raw::pack( s, uint8_t(variant::int64_type) );
+               s.write( a.data, a.size );
+               break;
+            case log_args::uint_arg:
+               fc::raw::pack( s, uint8_t(variant::uint64_type) );
+               s.write( a.data, a.size );
+               break;
+            case log_args::double_arg:
+               fc::raw::pack( s, uint8_t(variant::double_type) );
+               s.write( a.data, a.size );
+               break;
+            case log_args::bool_arg:
+               fc::raw::pack( s, uint8_t(variant::bool_type) );
+               s.write( a.data, a.size );
+               break;
+            case log_args::string_arg:
+               fc::raw::pack( s, uint8_t(variant::string_type) );
+               fc::raw::pack( s, unsigned_int( uint32_t(a.size) ) );
+               s.write( a.data, a.size );
+               break;
+            default:
+               fc::raw::pack( s, a.value( *args ) );
+         }
+      }
+   }
+
+} } // fc::raw
+
+namespace fc { namespace detail {
+
+   static fc::path segment_path( const fc::path& filename, uint32_t index )
+   {
+      return fc::path( filename.string() + "." + fc::to_string( uint64_t(index) ) );
+   }
+
+   template<typename T>
+   static size_t packed_size( const T& v )
+   {
+      fc::datastream<size_t> ps;
+      fc::raw::pack( ps, v );
+      return ps.tellp();
+   }
+} } // fc::detail
+
+namespace fc {
+
+   class binary_appender::impl : public fc::retainable {
+      public:
+         impl():base(nullptr),index(0),sequence(0),next_site_id(0){}
+
+         config                                       cfg;
+         boost::mutex                                 slock;
+
+         std::unique_ptr<file_mapping>                mapping;
+         std::unique_ptr<mapped_region>               region;
+         char*                                        base;
+         uint32_t                                     index;
+         uint64_t                                     sequence;
+
+         /** sites already written to the current segment */
+         std::unordered_map<const void*,uint32_t>     site_ids;
+         /** sites of messages that were not created by the log macros, keyed by file:line:format */
+         std::unordered_map<fc::string,uint32_t>      dynamic_site_ids;
+         uint32_t                                     next_site_id;
+
+         detail::binary_log_header& header() { return *reinterpret_cast<detail::binary_log_header*>(base); }
+
+         /** continues after the newest segment left by a previous run */
+         void resume()
+         {
+            uint64_t newest = 0;
+            bool     found  = false;
+            for( uint32_t i = 0; i < cfg.segment_count; ++i )
+            {
+               auto p = detail::segment_path( cfg.filename, i );
+               if( !fc::exists( p ) || fc::file_size( p ) < sizeof(detail::binary_log_header) ) continue;
+
+               file_mapping  fm( p.string().c_str(), read_only );
+               mapped_region r( fm, read_only, 0, sizeof(detail::binary_log_header) );
+               detail::binary_log_header h;
+               memcpy( &h, r.get_address(), sizeof(h) );
+               if( h.magic == detail::binary_log_magic && (!found || h.sequence >= newest) )
+               {
+                  newest = h.sequence;
+                  found  = true;
+               }
+            }
+            sequence = found ? newest + 1 : 0;
+         }
+
+         void start_segment()
+         {
+            region.reset();
+            mapping.reset();
+
+            index = uint32_t( sequence % cfg.segment_count );
+            auto p = detail::segment_path( cfg.filename, index );
+            if( !fc::exists( p ) ) fc::ofstream create( p );
+            if( fc::file_size( p ) != cfg.segment_size ) fc::resize_file( p, cfg.segment_size );
+
+            mapping.reset( new file_mapping( p.string().c_str(), read_write ) );
+            region.reset( new mapped_region( *mapping, read_write, 0, cfg.segment_size ) );
+            base = static_cast<char*>( region->get_address() );
+
+            detail::binary_log_header& h = header();
+            h.magic    = detail::binary_log_magic;
+            h.version  = detail::binary_log_version;
+            h.reserved = 0;
+            h.sequence = sequence++;
+            h.used     = sizeof(detail::binary_log_header);
+
+            site_ids.clear();
+            dynamic_site_ids.clear();
+            next_site_id = 0;
+         }
+
+         template<typename T>
+         void append( uint8_t type, const T& v, size_t size )
+         {
+            char* pos = base + header().used;
+            uint32_t s = uint32_t(size);
+            memcpy( pos, &type, sizeof(type) );
+            memcpy( pos + sizeof(type), &s, sizeof(s) );
+            fc::datastream<char*> ds( pos + detail::record_prefix_size, size );
+            fc::raw::pack( ds, v );
+            // publish the record only once it is complete
+            header().used += detail::record_prefix_size + size;
+         }
+
+         /**
+          *  @return the id of the message's site in the current segment, if the
+          *  site has not been written yet @param site is filled in instead.
+          */
+         uint32_t find_site( const log_message& m, const log_context& ctx, detail::binary_log_site& site, bool& is_new )
+         {
+            const log_site* s = m.get_site();
+            fc::string key;
+            if( s )
+            {
+               auto itr = site_ids.find( s );
+               if( itr != site_ids.end() ) { is_new = false; return itr->second; }
+            }
+            else
+            {
+               key = ctx.get_file() + ":" + fc::to_string( ctx.get_line_number() ) + ":" + m.get_format();
+               auto itr = dynamic_site_ids.find( key );
+               if( itr != dynamic_site_ids.end() ) { is_new = false; return itr->second; }
+            }
+
+            is_new      = true;
+            site.id     = next_site_id;
+            site.level  = ctx.get_log_level();
+            site.file   = ctx.get_file();
+            site.line   = ctx.get_line_number();
+            site.method = ctx.get_method();
+            site.format = m.get_format();
+            return site.id;
+         }
+
+         void remember_site( const log_message& m, const log_context& ctx, uint32_t id )
+         {
+            const log_site* s = m.get_site();
+            if( s ) site_ids[s] = id;
+            else    dynamic_site_ids[ ctx.get_file() + ":" + fc::to_string( ctx.get_line_number() ) + ":" + m.get_format() ] = id;
+            ++next_site_id;
+         }
+
+         void write( const log_message& m )
+         {
+            log_context ctx = m.get_context();
+            detail::binary_log_record rec;
+            rec.timestamp   = ctx.get_timestamp().time_since_epoch().count();
+            rec.thread_name = ctx.get_thread_name();
+            rec.context     = ctx.get_context();
+            rec.scope       = ctx.get_scope();
+            detail::binary_log_message msg = { &rec, &m };
+
+            // the second attempt starts from an empty segment, a message that
+            // still does not fit is larger than a segment and is dropped
+            for( int attempt = 0; attempt < 2; ++attempt )
+            {
+               detail::binary_log_site site;
+               bool   new_site = false;
+               rec.site = find_site( m, ctx, site, new_site );
+
+               size_t site_size = new_site ? detail::packed_size( site ) : 0;
+               size_t rec_size  = detail::packed_size( msg );
+               size_t needed    = rec_size + detail::record_prefix_size
+                                + (new_site ? site_size + detail::record_prefix_size : 0);
+
+               if( header().used + needed > cfg.segment_size )
+               {
+                  start_segment();
+                  continue;
+               }
+
+               if( new_site )
+               {
+                  append( detail::site_record, site, site_size );
+                  remember_site( m, ctx, site.id );
+               }
+               append( detail::message_record, msg, rec_size );
+               return;
+            }
+         }
+   };
+
+   binary_appender::config::config( const fc::path& p )
+   :filename(p),segment_size(16*1024*1024),segment_count(4){}
+
+   binary_appender::binary_appender( const variant& args )
+   :my( new impl() )
+   {
+      my->cfg = args.as<config>();
+      FC_ASSERT( my->cfg.segment_count > 0 );
+      FC_ASSERT( my->cfg.segment_size > sizeof(detail::binary_log_header) );
+      if( my->cfg.filename.parent_path().string().size() )
+         fc::create_directories( my->cfg.filename.parent_path() );
+      my->resume();
+      my->start_segment();
+   }
+
+   binary_appender::~binary_appender()
+   {
+      if( my->region ) my->region->flush();
+   }
+
+   void binary_appender::log( const log_message& m )
+   {
+      log_batch( &m, 1 );
+   }
+
+   void binary_appender::log_batch( const log_message* msgs, size_t count )
+   {
+      fc::scoped_lock<boost::mutex> lock(my->slock);
+      for( size_t i = 0; i < count; ++i )
+      {
+         try { my->write( msgs[i] ); } catch ( ... ) {}
+      }
+   }
+
+   std::vector<log_message> read_binary_log( const fc::path& filename )
+   {
+      struct segment
+      {
+         uint64_t          sequence;
+         std::vector<char> data;
+      };
+      std::vector<segment> segments;
+
+      for( uint32_t i = 0; fc::exists( detail::segment_path( filename, i ) ); ++i )
+      {
+         auto p = detail::segment_path( filename, i );
+         if( fc::file_size( p ) < sizeof(detail::binary_log_header) ) continue;
+
+         file_mapping  fm( p.string().c_str(), read_only );
+         mapped_region r( fm, read_only );
+         const char*   d = static_cast<const char*>( r.get_address() );
+         FC_ASSERT( r.get_size() >= sizeof(detail::binary_log_header), "truncated binary log segment ${p}", ("p",p) );
+
+         detail::binary_log_header h;
+         memcpy( &h, d, sizeof(h) );
+         if( h.magic != detail::binary_log_magic || h.version != detail::binary_log_version ) continue;
+         FC_ASSERT( h.used >= sizeof(h) && h.used <= r.get_size(), "corrupt binary log segment ${p}", ("p",p) );
+
+         segment s;
+         s.sequence = h.sequence;
+         s.data.assign( d + sizeof(h), d + h.used );
+         segments.push_back( std::move(s) );
+      }
+      std::sort( segments.begin(), segments.end(), []( const segment& a, const segment& b ) {
+         return a.sequence < b.sequence;
+      });
+
+      std::vector<log_message> result;
+      for( auto seg = segments.begin(); seg != segments.end(); ++seg )
+      {
+         std::unordered_map<uint32_t,detail::binary_log_site> sites;
+         size_t pos = 0;
+         while( pos + detail::record_prefix_size <= seg->data.size() )
+         {
+            uint8_t  type;
+            uint32_t size;
+            memcpy( &type, seg->data.data() + pos, sizeof(type) );
+            memcpy( &size, seg->data.data() + pos + sizeof(type), sizeof(size) );
+            pos += detail::record_prefix_size;
+            FC_ASSERT( pos + size <= seg->data.size(), "truncated binary log record" );
+
+            fc::datastream<const char*> ds( seg->data.data() + pos, size );
+            pos += size;
+
+            if( type == detail::site_record )
+            {
+               detail::binary_log_site site;
+               fc::raw::unpack( ds, site );
+               sites[site.id] = site;
+            }
+            else if( type == detail::message_record )
+            {
+               detail::binary_log_record rec;
+               variant_object            args;
+               fc::raw::unpack( ds, rec );
+               fc::raw::unpack( ds, args );
+               auto site = sites.find( rec.site );
+               if( site == sites.end() ) continue;
+
+               mutable_variant_object ctx;
+               ctx( "level",       variant( log_level( site->second.level ) ) )
+                  ( "file",        site->second.file )
+                  ( "line",        site->second.line )
+                  ( "method",      site->second.method )
+                  ( "hostname",    "" )
+                  ( "thread_name", rec.thread_name )
+                  ( "timestamp",   variant( time_point( microseconds( rec.timestamp ) ) ) );
+               if( rec.context.size() )
+                  ctx( "context", rec.context );
+               if( rec.scope.size() )
+                  ctx( "scope", rec.scope );
+
+               result.push_back( log_message( variant( mutable_variant_object( "context", variant_object(ctx) )
+                                                                              ( "format",  site->second.format )
+                                                                              ( "data",    args ) ) ) );
+            }
+         }
+      }
+      return result;
+   }
+
+} // namespace fc
@@ -3,6 +3,7 @@
 #include <fc/thread/unique_lock.hpp>
 #include <fc/string.hpp>
 #include <fc/variant.hpp>
+#include <fc/io/json.hpp>
 #include <fc/reflect/variant.hpp>
 #ifndef WIN32
 #include <unistd.h>
@@ -60,18 +61,11 @@ namespace fc {
    const char* console_appender::get_color( log_level l )const {
       return get_console_color( lc[l] ); 
    }
-   void console_appender::log( const log_message& m ) {
-      //fc::string message = fc::format_string( m.get_format(), m.get_data() );
-      //fc::variant lmsg(m);
-
-      FILE* out = stream::std_error ? stderr : stdout;
-
-      //fc::string fmt_str = fc::format_string( cfg.format, mutable_variant_object(m.get_context())( "message", message)  );
+   static void format_line( std::stringstream& line, const log_message& m ) {
       std::stringstream file_line;
       file_line << m.get_context().get_file() <<":"<<m.get_context().get_line_number() <<" ";
 
       ///////////////
-      std::stringstream line;
       line << (m.get_context().get_timestamp().time_since_epoch().count() % (1000ll*1000ll*60ll*60))/1000 <<"ms ";
       line << std::setw( 10 ) << std::left << m.get_context().get_thread_name().substr(0,9).c_str() <<" "<<std::setw(30)<< std::left <<file_line.str();
 
@@ -89,23 +83,38 @@ namespace fc {
          line << std::setw( 20 ) << std::left << m.get_context().get_method().substr(p,20).c_str() <<" ";
       }
       line << "] ";
-      fc::string message = fc::format_string( m.get_format(), m.get_data() );
+      fc::string message = m.get_message();
       line << message;//.c_str();
-      //
-      //
+      auto scope = m.get_context().get_scope();
+      if( scope.size() ) line << " " << fc::json::to_string( scope );
+   }
 
+   void console_appender::log( const log_message& m ) {
+      log_batch( &m, 1 );
+   }
+
+   void console_appender::log_batch( const log_message* msgs, size_t count ) {
+      FILE* out = cfg.stream == stream::std_error ? stderr : stdout;
 
-      fc::unique_lock<boost::mutex> lock(log_mutex());
       #ifndef WIN32
-      if(isatty(fileno(out))) fprintf( out, "\r%s", get_color( m.get_context().get_log_level() ) );
+      bool tty = isatty(fileno(out));
+      #else
+      bool tty = false;
       #endif
 
-      fprintf( out, "%s", line.str().c_str()); //fmt_str.c_str() ); 
+      std::stringstream lines;
+      for( size_t i = 0; i < count; ++i )
+      {
+         //fc::string fmt_str = fc::format_string( cfg.format, mutable_variant_object(m.get_context())( "message", message)  );
+         if( tty ) lines << "\r" << get_color( msgs[i].get_context().get_log_level() );
+         format_line( lines, msgs[i] );
+         if( tty ) lines << "\r" << CONSOLE_DEFAULT;
+         lines << "\n";
+      }
+      auto text = lines.str();
 
-      #ifndef WIN32
-      if(isatty(fileno(out))) fprintf( out, "\r%s", CONSOLE_DEFAULT );
-      #endif
-      fprintf( out, "\n" );
+      fc::unique_lock<boost::mutex> lock(log_mutex());
+      fwrite( text.c_str(), 1, text.size(), out );
       if( cfg.flush ) fflush( out );
    }
 
@@ -3,29 +3,179 @@
 #include <fc/thread/scoped_lock.hpp>
 #include <boost/thread/mutex.hpp>
 #include <fc/io/fstream.hpp>
+#include <fc/compress/lzma.hpp>
+#include <fc/thread/thread.hpp>
 #include <fc/variant.hpp>
+#include <fc/io/json.hpp>
 #include <fc/reflect/variant.hpp>
 #include <iomanip>
 #include <sstream>
+#include <algorithm>
+#include <string.h>
 
 
 namespace fc {
+   static const char compressed_suffix[] = ".lz";
+   /** the name a rotated file is compressed to before it is renamed to its final name */
+   static const char partial_suffix[]    = ".partial";
+
+   static bool ends_with( const fc::string& s, const char* suffix )
+   {
+      size_t n = strlen( suffix );
+      return s.size() >= n && s.compare( s.size() - n, n, suffix ) == 0;
+   }
+
+   static bool all_digits( const fc::string& s, size_t pos, size_t n )
+   {
+      for( size_t i = pos; i < pos + n; ++i )
+         if( s[i] < '0' || s[i] > '9' ) return false;
+      return true;
+   }
+
+   /** @return true if @param suffix is YYYYMMDDTHHMMSS-NNNN as generated by rotated_name() */
+   static bool is_rotation_suffix( const fc::string& suffix )
+   {
+      // the sequence number has at least four digits
+      if( suffix.size() < 20 ) return false;
+      return all_digits( suffix, 0, 8 ) && suffix[8] == 'T' && all_digits( suffix, 9, 6 ) &&
+             suffix[15] == '-' && all_digits( suffix, 16, suffix.size() - 16 );
+   }
+
+   /**
+    *  Removes the oldest rotated files until at most cfg.max_files are left.
+    *  A file and its compressed form count once, compressions in progress and
+    *  files that merely share the prefix are left alone.
+    */
+   static void prune_rotated_files( const file_appender::config& cfg )
+   {
+      fc::path dir = cfg.filename.parent_path();
+      if( dir.string().empty() ) dir = ".";
+      fc::string prefix = cfg.filename.filename().string() + ".";
+
+      std::vector<fc::string> rotated;
+      for( fc::directory_iterator itr( dir ), end; itr != end; ++itr )
+      {
+         fc::string name = (*itr).filename().string();
+         if( name.size() <= prefix.size() || name.compare( 0, prefix.size(), prefix ) != 0 ) continue;
+         if( ends_with( name, compressed_suffix ) ) name.resize( name.size() - strlen( compressed_suffix ) );
+         if( !is_rotation_suffix( name.substr( prefix.size() ) ) ) continue;
+         rotated.push_back( name );
+      }
+      // the suffix is a timestamp and a sequence number, so names sort oldest first
+      std::sort( rotated.begin(), rotated.end() );
+      rotated.erase( std::unique( rotated.begin(), rotated.end() ), rotated.end() );
+      for( size_t i = 0; i + cfg.max_files < rotated.size(); ++i )
+      {
+         fc::path file = dir / rotated[i];
+         fc::path compressed( file.string() + compressed_suffix );
+         if( fc::exists( file ) )       fc::remove( file );
+         if( fc::exists( compressed ) ) fc::remove( compressed );
+      }
+   }
+
+   /** runs on the rotation thread so that the logging threads never wait for it */
+   static void finish_rotation( const file_appender::config& cfg, const fc::path& rotated )
+   {
+      try {
+         if( cfg.compress )
+         {
+            // only complete files ever have the .lz name
+            fc::path partial( rotated.string() + compressed_suffix + partial_suffix );
+            lzma_compress_file( rotated, partial );
+            fc::rename( partial, fc::path( rotated.string() + compressed_suffix ) );
+            fc::remove( rotated );
+         }
+         if( cfg.max_files )
+            prune_rotated_files( cfg );
+      } catch ( ... ) {
+      }
+   }
+
+   /**
+    *  @return cfg.filename with a suffix of the form .YYYYMMDDTHHMMSS-NNNN, the
+    *  first sequence number that is not in use so rotations within one second
+    *  never overwrite each other.  Names sort in the order they were created.
+    */
+   static fc::path rotated_name( const file_appender::config& cfg )
+   {
+      fc::string base = cfg.filename.string() + "." + fc::string( time_point( time_point_sec( time_point::now() ) ) ) + "-";
+      for( uint32_t seq = 0; ; ++seq )
+      {
+         std::stringstream suffix;
+         suffix << std::setw( 4 ) << std::setfill( '0' ) << seq;
+         fc::path name( base + suffix.str() );
+         if( !fc::exists( name ) && !fc::exists( fc::path( name.string() + compressed_suffix ) ) &&
+             !fc::exists( fc::path( name.string() + compressed_suffix + partial_suffix ) ) )
+            return name;
+      }
+   }
+
    class file_appender::impl : public fc::retainable {
       public:
+         impl():bytes_written(0){}
+         ~impl()
+         {
+            if( !rotation_thread ) return;
+            // tasks run in order, so the last one finishing means every compression is complete
+            try { if( last_rotation.valid() ) last_rotation.wait(); } catch ( ... ) {}
+            rotation_thread->quit();
+         }
+
          config                      cfg;
          ofstream                    out;
          boost::mutex        slock;
+
+         uint64_t                    bytes_written;
+         time_point                  next_rotation;
+         /** compresses and prunes rotated files, started by the first rotation that needs it */
+         std::unique_ptr<fc::thread> rotation_thread;
+         fc::future<void>            last_rotation;
+
+         void open()
+         {
+            out.open( cfg.filename.string().c_str() );
+            bytes_written = 0;
+            if( cfg.rotate_interval )
+               next_rotation = time_point::now() + fc::seconds( cfg.rotate_interval );
+         }
+
+         bool should_rotate()const
+         {
+            return (cfg.rotate_size && bytes_written >= cfg.rotate_size) ||
+                   (cfg.rotate_interval && time_point::now() >= next_rotation);
+         }
+
+         /** called with slock held, only renames the file and leaves the slow work to rotation_thread */
+         void rotate()
+         {
+            out.close();
+            fc::path rotated = rotated_name( cfg );
+            try {
+               fc::rename( cfg.filename, rotated );
+            } catch ( ... ) {
+               open();
+               throw;
+            }
+            open();
+
+            if( cfg.compress || cfg.max_files )
+            {
+               if( !rotation_thread ) rotation_thread.reset( new fc::thread( "file_appender" ) );
+               config c = cfg;
+               last_rotation = rotation_thread->async( [c,rotated]() { finish_rotation( c, rotated ); }, "file_appender::rotate" );
+            }
+         }
    };
    file_appender::config::config( const fc::path& p  )
    :format( "${timestamp} ${thread_name} ${context} ${file}:${line} ${method} ${level}]  ${message}" ),
-   filename(p),flush(true),truncate(true){}
+   filename(p),flush(true),truncate(true),rotate_size(0),rotate_interval(0),compress(false),max_files(0){}
 
    file_appender::file_appender( const variant& args )
    :my( new impl() )
    {
       try {
          my->cfg = args.as<config>(); 
-         my->out.open( my->cfg.filename.string().c_str() );
+         my->open();
       } catch ( ... ) {
          //elog( "%s", fc::except_str().c_str() );
       }
@@ -33,9 +183,8 @@ namespace fc {
    file_appender::~file_appender(){}
 
    // MS THREAD METHOD  MESSAGE \t\t\t File:Line
-   void file_appender::log( const log_message& m )
+   static void format_line( std::stringstream& line, const log_message& m )
    {
-      std::stringstream line;
       line << (m.get_context().get_timestamp().time_since_epoch().count() % (1000ll*1000ll*60ll*60))/1000 <<"ms ";
       line << std::setw( 10 ) << m.get_context().get_thread_name().substr(0,9).c_str() <<" ";
 
@@ -53,17 +202,38 @@ namespace fc {
          line << std::setw( 20 ) << m.get_context().get_method().substr(p,20).c_str() <<" ";
       }
       line << "] ";
-      fc::string message = fc::format_string( m.get_format(), m.get_data() );
+      fc::string message = m.get_message();
       line << message.c_str();
+      auto scope = m.get_context().get_scope();
+      if( scope.size() ) line << " " << fc::json::to_string( scope ).c_str();
 
 
       //fc::variant lmsg(m);
 
      // fc::string fmt_str = fc::format_string( my->cfg.format, mutable_variant_object(m.get_context())( "message", message)  );
-      {
-        fc::scoped_lock<boost::mutex> lock(my->slock);
-        my->out << line.str() << "\t\t\t" << m.get_context().get_file() <<":"<<m.get_context().get_line_number()<<"\n";
+      line << "\t\t\t" << m.get_context().get_file() <<":"<<m.get_context().get_line_number()<<"\n";
+   }
+
+   void file_appender::log( const log_message& m )
+   {
+      log_batch( &m, 1 );
+   }
+
+   void file_appender::log_batch( const log_message* msgs, size_t count )
+   {
+      std::stringstream lines;
+      for( size_t i = 0; i < count; ++i )
+         format_line( lines, msgs[i] );
+
+      fc::string data = lines.str();
+
+      fc::scoped_lock<boost::mutex> lock(my->slock);
+      try {
+         if( my->should_rotate() ) my->rotate();
+      } catch ( ... ) {
       }
+      my->out << data;
+      my->bytes_written += data.size();
       if( my->cfg.flush ) my->out.flush();
    }
 }
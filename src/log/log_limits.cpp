@@ -0,0 +1,158 @@
+#include <fc/log/logger_config.hpp>
+#include <fc/log/logger.hpp>
+#include <fc/log/log_message.hpp>
+#include <fc/time.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/atomic.hpp>
+#include <memory>
+
+namespace fc
+{
+   namespace detail
+   {
+      /** the rate limiting state of one log_site */
+      struct log_site_state
+      {
+         log_site_state( const log_site& s )
+         :site(s),file(s.file),line(s.line),limited(false),max_per_second(0),sample_rate(0),
+          hits(0),window(0),window_count(0),suppressed(0),target(nullptr){}
+
+         const log_site&           site;
+         const fc::string          file;
+         const uint64_t            line;
+
+         boost::atomic<bool>       limited;
+         boost::atomic<uint32_t>   max_per_second;
+         boost::atomic<uint32_t>   sample_rate;
+
+         boost::atomic<uint64_t>   hits;
+         /** the second window_count refers to */
+         boost::atomic<int64_t>    window;
+         boost::atomic<uint32_t>   window_count;
+         boost::atomic<uint64_t>   suppressed;
+
+         /** the logger that dropped the messages counted by suppressed */
+         boost::mutex              target_mutex;
+         logger                    target;
+
+         void apply( const std::vector<log_limit_config>& limits )
+         {
+            const log_limit_config* best = nullptr;
+            int best_rank = -1;
+            for( auto itr = limits.begin(); itr != limits.end(); ++itr )
+            {
+               if( itr->file.size() && itr->file != file ) continue;
+               if( itr->line && (itr->line != line || itr->file.empty()) ) continue;
+               int rank = itr->line ? 2 : itr->file.size() ? 1 : 0;
+               if( rank >= best_rank )
+               {
+                  best      = &*itr;
+                  best_rank = rank;
+               }
+            }
+            max_per_second.store( best ? best->max_per_second : 0, boost::memory_order_relaxed );
+            sample_rate.store( best ? best->sample_rate : 0, boost::memory_order_relaxed );
+            limited.store( best && (best->max_per_second || best->sample_rate > 1), boost::memory_order_release );
+         }
+
+         bool admit()
+         {
+            uint32_t rate = sample_rate.load( boost::memory_order_relaxed );
+            if( rate > 1 && hits.fetch_add( 1, boost::memory_order_relaxed ) % rate != 0 )
+               return false;
+
+            uint32_t max = max_per_second.load( boost::memory_order_relaxed );
+            if( !max ) return true;
+
+            int64_t now = time_point::now().time_since_epoch().count() / 1000000;
+            int64_t w   = window.load( boost::memory_order_relaxed );
+            if( w != now && window.compare_exchange_strong( w, now, boost::memory_order_relaxed ) )
+               window_count.store( 0, boost::memory_order_relaxed );
+            return window_count.fetch_add( 1, boost::memory_order_relaxed ) < max;
+         }
+      };
+
+      struct log_site_registry
+      {
+         boost::mutex                                   mutex;
+         std::vector<std::unique_ptr<log_site_state>>   sites;
+         std::vector<log_limit_config>                  limits;
+      };
+
+      static log_site_registry& get_log_site_registry()
+      {
+         // never destroyed so that sites used during static destruction stay valid
+         static log_site_registry* r = new log_site_registry();
+         return *r;
+      }
+
+      log_site_state* register_log_site( const log_site& site )
+      {
+         log_site_registry& r = get_log_site_registry();
+         boost::unique_lock<boost::mutex> lock( r.mutex );
+         r.sites.push_back( std::unique_ptr<log_site_state>( new log_site_state( site ) ) );
+         r.sites.back()->apply( r.limits );
+         return r.sites.back().get();
+      }
+   }
+
+   bool log_site::should_log( const logger& l )const
+   {
+      if( !_state->limited.load( boost::memory_order_acquire ) )
+         return true;
+      if( _state->admit() )
+         return true;
+      // only the first drop since the count was last reported records the logger
+      if( _state->suppressed.fetch_add( 1, boost::memory_order_relaxed ) == 0 )
+      {
+         boost::unique_lock<boost::mutex> lock( _state->target_mutex );
+         _state->target = l;
+      }
+      return false;
+   }
+
+   uint64_t log_site::take_suppressed()const
+   {
+      if( !_state->suppressed.load( boost::memory_order_relaxed ) )
+         return 0;
+      return _state->suppressed.exchange( 0, boost::memory_order_relaxed );
+   }
+
+   void flush_suppressed_log_messages()
+   {
+      std::vector<std::pair<logger,log_message>> reports;
+      {
+         detail::log_site_registry& r = detail::get_log_site_registry();
+         boost::unique_lock<boost::mutex> lock( r.mutex );
+         for( auto itr = r.sites.begin(); itr != r.sites.end(); ++itr )
+         {
+            detail::log_site_state& s = **itr;
+            logger target( nullptr );
+            {
+               boost::unique_lock<boost::mutex> target_lock( s.target_mutex );
+               std::swap( target, s.target );
+            }
+            uint64_t n = s.site.take_suppressed();
+            if( !n || target == nullptr ) continue;
+
+            reports.push_back( std::make_pair( target, log_message( log_context( s.site ), "${_suppressed} similar messages suppressed",
+                                                                    mutable_variant_object( "_suppressed", n ) ) ) );
+         }
+      }
+      // logged without the registry lock, appenders may register sites of their own
+      for( auto itr = reports.begin(); itr != reports.end(); ++itr )
+         itr->first.log( itr->second );
+   }
+
+   void configure_log_limits( const std::vector<log_limit_config>& limits )
+   {
+      flush_suppressed_log_messages();
+
+      detail::log_site_registry& r = detail::get_log_site_registry();
+      boost::unique_lock<boost::mutex> lock( r.mutex );
+      r.limits = limits;
+      for( auto itr = r.sites.begin(); itr != r.sites.end(); ++itr )
+         (*itr)->apply( limits );
+   }
+
+} // namespace fc
@@ -7,14 +7,21 @@
 #include <fc/filesystem.hpp>
 #include <fc/io/stdio.hpp>
 #include <fc/io/json.hpp>
+#include <string.h>
 
 namespace fc
 {
    namespace detail
    {
+      log_site_state* register_log_site( const log_site& site );
+
       class log_context_impl
       {
          public:
+            log_context_impl():site(nullptr){}
+
+            /** when set, file and method are read from the site instead */
+            const log_site* site;
             log_level level;
             string       file;
             uint64_t     line;
@@ -23,21 +30,177 @@ namespace fc
             string       hostname;
             string       context;
             time_point   timestamp;
+            log_scope_ptr scope;
+      };
+
+      struct log_context_link
+      {
+         log_context_link( std::shared_ptr<const log_context_link> p, std::shared_ptr<const fc::string> n )
+         :prev( std::move(p) ),name( std::move(n) ){}
+
+         std::shared_ptr<const log_context_link> prev;
+         std::shared_ptr<const fc::string>       name;
       };
 
       class log_message_impl
       {
          public:
             log_message_impl( log_context&& ctx )
-            :context( std::move(ctx) ){}
-            log_message_impl(){}
+            :context( std::move(ctx) ),site(nullptr),suppressed(0){}
+            log_message_impl():site(nullptr),suppressed(0){}
 
             log_context     context;
+            /** when set, format is read from the site and formatted with its segments */
+            const log_site* site;
+            /** messages dropped by the site's rate limit since the previous one */
+            uint64_t        suppressed;
             string          format;
             variant_object  args;
+            /** the arguments of messages created by the log macros, args is empty then */
+            log_args        captured;
       };
    }
 
+   void log_args::add_key( const char* key, size_t len )
+   {
+      uint32_t l = uint32_t(len);
+      if( !_data.capacity() ) _data.reserve( 128 );
+      _data.insert( _data.end(), (const char*)&l, (const char*)&l + sizeof(l) );
+      _data.insert( _data.end(), key, key + len );
+   }
+
+   void log_args::add_bytes( arg_type t, const void* p, size_t len )
+   {
+      if( _data.capacity() == _data.size() ) _data.reserve( std::max<size_t>( 128, 2 * _data.size() ) );
+      _data.push_back( char(t) );
+      _data.insert( _data.end(), (const char*)p, (const char*)p + len );
+   }
+
+   void log_args::add_int( int64_t v )    { add_bytes( int_arg, &v, sizeof(v) ); }
+   void log_args::add_uint( uint64_t v )  { add_bytes( uint_arg, &v, sizeof(v) ); }
+   void log_args::add_value( double v )   { add_bytes( double_arg, &v, sizeof(v) ); }
+   void log_args::add_value( bool v )     { add_bytes( bool_arg, &v, sizeof(v) ); }
+
+   void log_args::add_value( const char* v )
+   {
+      uint32_t len = uint32_t(strlen( v ));
+      add_bytes( string_arg, &len, sizeof(len) );
+      _data.insert( _data.end(), v, v + len );
+   }
+
+   void log_args::add_value( const fc::string& v )
+   {
+      uint32_t len = uint32_t(v.size());
+      add_bytes( string_arg, &len, sizeof(len) );
+      _data.insert( _data.end(), v.begin(), v.end() );
+   }
+
+   void log_args::add_value( const variant& v )
+   {
+      uint32_t index = uint32_t(_variants.size());
+      _variants.push_back( v );
+      add_bytes( variant_arg, &index, sizeof(index) );
+   }
+
+   bool log_args::next( size_t& pos, arg& a )const
+   {
+      if( pos >= _data.size() ) return false;
+      const char* p = _data.data() + pos;
+
+      uint32_t len;
+      memcpy( &len, p, sizeof(len) );
+      a.key      = p + sizeof(len);
+      a.key_size = len;
+      p += sizeof(len) + len;
+
+      a.type = arg_type( *p++ );
+      a.data = p;
+      switch( a.type )
+      {
+         case bool_arg:
+            a.size = sizeof(bool);
+            break;
+         case string_arg:
+         {
+            uint32_t len;
+            memcpy( &len, p, sizeof(len) );
+            a.data = p + sizeof(len);
+            a.size = len;
+            p += sizeof(len);
+            break;
+         }
+         case variant_arg:
+            a.size = sizeof(uint32_t);
+            break;
+         default:
+            a.size = 8;
+      }
+      pos = size_t( a.data + a.size - _data.data() );
+      return true;
+   }
+
+   bool log_args::find( const string& key, arg& a )const
+   {
+      bool   found = false;
+      size_t pos   = 0;
+      arg    cur;
+      while( next( pos, cur ) )
+      {
+         if( cur.key_size == key.size() && memcmp( cur.key, key.data(), key.size() ) == 0 )
+         {
+            a     = cur;
+            found = true;
+         }
+      }
+      return found;
+   }
+
+   variant log_args::arg::value( const log_args& args )const
+   {
+      switch( type )
+      {
+         case int_arg:    { int64_t v;  memcpy( &v, data, sizeof(v) ); return variant( v ); }
+         case uint_arg:   { uint64_t v; memcpy( &v, data, sizeof(v) ); return variant( v ); }
+         case double_arg: { double v;   memcpy( &v, data, sizeof(v) ); return variant( v ); }
+         case bool_arg:   { bool v;     memcpy( &v, data, sizeof(v) ); return variant( v ); }
+         case string_arg: return variant( fc::string( data, size ) );
+         default:
+         {
+            uint32_t index;
+            memcpy( &index, data, sizeof(index) );
+            return args._variants[index];
+         }
+      }
+   }
+
+   void log_args::arg::format( const log_args& args, string& out )const
+   {
+      switch( type )
+      {
+         case int_arg:    { int64_t v;  memcpy( &v, data, sizeof(v) ); out += fc::to_string( v ); return; }
+         case uint_arg:   { uint64_t v; memcpy( &v, data, sizeof(v) ); out += fc::to_string( v ); return; }
+         case string_arg: out.append( data, size ); return;
+         default:
+         {
+            variant v = value( args );
+            if( v.is_object() || v.is_array() )
+               out += json::to_string( v );
+            else
+               out += v.as_string();
+         }
+      }
+   }
+
+   variant_object log_args::to_variant_object()const
+   {
+      mutable_variant_object o;
+      size_t pos = 0;
+      arg    a;
+      while( next( pos, a ) )
+         o.set( fc::string( a.key, a.key_size ), a.value( *this ) );
+      return o;
+   }
+
 
 
    log_context::log_context()
@@ -53,6 +216,107 @@ namespace fc
       my->method      = method;
       my->timestamp   = time_point::now();
       my->thread_name = fc::thread::current().name();
+      my->scope       = log_scope::current();
+   }
+
+   log_context::log_context( const log_site& site )
+   :my( std::make_shared<detail::log_context_impl>() )
+   {
+      my->site        = &site;
+      my->level       = site.level;
+      my->line        = site.line;
+      my->timestamp   = time_point::now();
+      my->thread_name = fc::thread::current().name();
+      my->scope       = log_scope::current();
+   }
+
+   log_site::log_site( log_level ll, const char* f, uint64_t l, const char* m, const char* fmt, bool is_literal )
+   :level(ll),file( fc::path(f).filename().generic_string() ),line(l),method(m),format(is_literal ? fmt : nullptr)
+   {
+      _state = detail::register_log_site( *this );
+      if( !is_literal ) return;
+      // split the format the same way format_string() scans it
+      string literal;
+      const char* c = fmt;
+      while( *c )
+      {
+         if( *c != '$' ) { literal += *c++; continue; }
+         ++c;
+         if( *c != '{' ) 
+         {
+            if( *c ) literal += *c++;
+            continue;
+         }
+         const char* close = strchr( c, '}' );
+         if( !close )
+         {
+            literal += c;
+            break;
+         }
+         if( literal.size() )
+         {
+            _segments.push_back( segment( std::move(literal), false ) );
+            literal.clear();
+         }
+         _segments.push_back( segment( string( c + 1, close ), true ) );
+         c = close + 1;
+      }
+      if( literal.size() )
+         _segments.push_back( segment( std::move(literal), false ) );
+   }
+
+   log_site::log_site( log_level ll, const char* f, uint64_t l, const char* m, const fc::string& )
+   :level(ll),file( fc::path(f).filename().generic_string() ),line(l),method(m),format(nullptr)
+   {
+      _state = detail::register_log_site( *this );
+   }
+
+   string log_site::format_message( const variant_object& args )const
+   {
+      string result;
+      for( auto itr = _segments.begin(); itr != _segments.end(); ++itr )
+      {
+         if( !itr->is_key )
+         {
+            result += itr->text;
+            continue;
+         }
+         auto val = args.find( itr->text );
+         if( val == args.end() )
+         {
+            result += "${";
+            result += itr->text;
+            result += "}";
+         }
+         else if( val->value().is_object() || val->value().is_array() )
+            result += json::to_string( val->value() );
+         else
+            result += val->value().as_string();
+      }
+      return result;
+   }
+
+   string log_site::format_message( const log_args& args )const
+   {
+      string result;
+      for( auto itr = _segments.begin(); itr != _segments.end(); ++itr )
+      {
+         if( !itr->is_key )
+         {
+            result += itr->text;
+            continue;
+         }
+         log_args::arg a;
+         if( args.find( itr->text, a ) )
+            a.format( args, result );
+         else
+         {
+            result += "${";
+            result += itr->text;
+            result += "}";
+         }
+      }
+      return result;
    }
 
    log_context::log_context( const variant& v )
@@ -63,22 +327,31 @@ namespace fc
        my->file         = obj["file"].as_string();
        my->line         = obj["line"].as_uint64();
        my->method       = obj["method"].as_string();
-       my->method       = obj["hostname"].as_string();
+       my->hostname     = obj["hostname"].as_string();
        my->thread_name  = obj["thread_name"].as_string();
        my->timestamp    = obj["timestamp"].as<time_point>();
        if( obj.contains( "context" ) )
            my->context      = obj["context"].as<string>();
+       if( obj.contains( "scope" ) )
+           my->scope        = log_scope::from_variant_object( obj["scope"].get_object() );
    }
 
    fc::string log_context::to_string()const
    {
-      return my->thread_name + "  " + my->file + ":" + fc::to_string(my->line) + " " + my->method;
+      return my->thread_name + "  " + get_file() + ":" + fc::to_string(my->line) + " " + get_method();
 
    }
 
    void log_context::append_context( const fc::string& s )
    {
-        my->context += "->" + s;
+        _chain = std::make_shared<const detail::log_context_link>( std::move(_chain), std::make_shared<const fc::string>( s ) );
+   }
+
+   log_context log_context::with_context( const fc::string& s )const
+   {
+        log_context c( *this );
+        c.append_context( s );
+        return c;
    }
 
    log_context::~log_context(){}
@@ -145,28 +418,47 @@ namespace fc
 
 
 
-   string     log_context::get_file()const       { return my->file; }
+   string     log_context::get_file()const       { return my->site ? my->site->file : my->file; }
    uint64_t   log_context::get_line_number()const { return my->line; }
-   string     log_context::get_method()const     { return my->method; }
+   string     log_context::get_method()const     { return my->site ? my->site->method : my->method; }
    string     log_context::get_thread_name()const { return my->thread_name; }
    string     log_context::get_host_name()const   { return my->hostname; }
    time_point  log_context::get_timestamp()const  { return my->timestamp; }
    log_level  log_context::get_log_level()const{ return my->level;   }
+   string     log_context::get_context()const
+   {
+      if( !_chain ) return my->context;
+      std::vector<const fc::string*> names;
+      for( auto l = _chain.get(); l; l = l->prev.get() )
+         names.push_back( l->name.get() );
+
+      string result = my->context;
+      for( auto itr = names.rbegin(); itr != names.rend(); ++itr )
+      {
+         result += "->";
+         result += **itr;
+      }
+      return result;
+   }
+   variant_object log_context::get_scope()const { return my->scope ? log_scope::to_variant_object( my->scope ) : variant_object(); }
 
 
    variant log_context::to_variant()const
    {
       mutable_variant_object o;
               o( "level",        variant(my->level)      )
-               ( "file",         my->file                )
+               ( "file",         get_file()              )
                ( "line",         my->line                )
-               ( "method",       my->method              )
+               ( "method",       get_method()            )
                ( "hostname",     my->hostname            )
                ( "thread_name",  my->thread_name         )
                ( "timestamp",    variant(my->timestamp)  );
 
-      if( my->context.size() ) 
-         o( "context",      my->context             );
+      auto context = get_context();
+      if( context.size() ) 
+         o( "context",      std::move(context)      );
+      if( my->scope )
+         o( "scope",        get_scope()             );
 
       return o;
    }
@@ -182,27 +474,112 @@ namespace fc
       my->args    = std::move(args);
    }
 
+   log_message::log_message( const log_site& site, const char* format, variant_object args )
+   :my( std::make_shared<detail::log_message_impl>( log_context(site) ) )
+   {
+      if( site.format && format == site.format )
+         my->site = &site;
+      else
+         my->format = format;
+      my->args = std::move(args);
+      add_suppressed( site );
+   }
+
+   log_message::log_message( const log_site& site, const fc::string& format, variant_object args )
+   :my( std::make_shared<detail::log_message_impl>( log_context(site) ) )
+   {
+      my->format  = format;
+      my->args    = std::move(args);
+      add_suppressed( site );
+   }
+
+   log_message::log_message( const log_site& site, const char* format, log_args args )
+   :my( std::make_shared<detail::log_message_impl>( log_context(site) ) )
+   {
+      if( site.format && format == site.format )
+         my->site = &site;
+      else
+         my->format = format;
+      my->captured = std::move(args);
+      add_suppressed( site );
+   }
+
+   log_message::log_message( const log_site& site, const fc::string& format, log_args args )
+   :my( std::make_shared<detail::log_message_impl>( log_context(site) ) )
+   {
+      my->format   = format;
+      my->captured = std::move(args);
+      add_suppressed( site );
+   }
+
+   void log_message::add_suppressed( const log_site& site )
+   {
+      my->suppressed = site.take_suppressed();
+      if( !my->suppressed ) return;
+      if( my->args.size() || my->captured.empty() )
+         my->args = mutable_variant_object( my->args )( "_suppressed", my->suppressed );
+      else
+         my->captured( "_suppressed", my->suppressed );
+   }
+
    log_message::log_message( const variant& v )
    :my( std::make_shared<detail::log_message_impl>( log_context( v.get_object()["context"] ) ) )
    {
       my->format = v.get_object()["format"].as_string();
       my->args   = v.get_object()["data"].get_object();
+      auto s = my->args.find( "_suppressed" );
+      if( s != my->args.end() ) my->suppressed = s->value().as_uint64();
    }
 
    variant log_message::to_variant()const
    {
-      return mutable_variant_object( "context", my->context )
-                          ( "format",  my->format )
-                          ( "data",    my->args   );
+      return mutable_variant_object( "context", get_context() )
+                          ( "format",  get_format() )
+                          ( "data",    get_data() );
    }
 
-   log_context          log_message::get_context()const { return my->context; }
-   string              log_message::get_format()const  { return my->format;  }
-   variant_object log_message::get_data()const    { return my->args;    }
+   log_context          log_message::get_context()const
+   {
+      if( !_chain ) return my->context;
+      log_context c( my->context );
+      c._chain = _chain;
+      return c;
+   }
+   string              log_message::get_format()const  { return my->site ? my->site->format : my->format;  }
+   variant_object log_message::get_data()const
+   {
+      return my->captured.empty() ? my->args : my->captured.to_variant_object();
+   }
+   const log_args* log_message::get_args()const
+   {
+      return my->captured.empty() ? nullptr : &my->captured;
+   }
+   const log_site* log_message::get_site()const   { return my->site;    }
+
+   log_message log_message::with_context( const fc::string& c )const
+   {
+      return with_context( std::make_shared<const fc::string>( c ) );
+   }
+
+   log_message log_message::with_context( std::shared_ptr<const fc::string> c )const
+   {
+      log_message m( *this );
+      m._chain = std::make_shared<const detail::log_context_link>( _chain ? _chain : my->context._chain, std::move(c) );
+      return m;
+   }
 
    string        log_message::get_message()const
    {
-      return format_string( my->format, my->args );
+      string msg;
+      if( !my->site )
+         msg = format_string( my->format, get_data() );
+      else if( my->captured.empty() )
+         msg = my->site->format_message( my->args );
+      else
+         msg = my->site->format_message( my->captured );
+      if( my->suppressed )
+         msg += " (" + fc::to_string( my->suppressed ) + " similar messages suppressed)";
+      return msg;
    }
 
 
@@ -0,0 +1,72 @@
+#include <fc/log/log_scope.hpp>
+#include <fc/variant.hpp>
+#include <fc/log/logger.hpp>
+#include "../thread/thread_d.hpp"
+
+namespace fc
+{
+   namespace detail
+   {
+      struct log_scope_node
+      {
+         log_scope_node( const fc::string& k, const variant& v, const log_scope_ptr& p )
+         :key(k),value(v),parent(p){}
+
+         fc::string    key;
+         variant       value;
+         log_scope_ptr parent;
+      };
+   }
+
+   log_scope_ptr& log_scope::fiber_scope()
+   {
+      thread_d* t = thread::current().my;
+      if( !t->current ) t->current = new fc::context( &fc::thread::current() );
+      return t->current->log_scope;
+   }
+
+   log_scope::log_scope( const fc::string& key, const variant& value )
+   {
+      log_scope_ptr& cur = fiber_scope();
+      _prev = cur;
+      cur = std::make_shared<detail::log_scope_node>( key, value, _prev );
+   }
+
+   log_scope::~log_scope()
+   {
+      fiber_scope() = std::move(_prev);
+   }
+
+   log_scope_ptr log_scope::current()
+   {
+      return fiber_scope();
+   }
+
+   log_scope_ptr log_scope::set_current( log_scope_ptr s )
+   {
+      log_scope_ptr& cur = fiber_scope();
+      std::swap( cur, s );
+      return s;
+   }
+
+   variant_object log_scope::to_variant_object( const log_scope_ptr& s )
+   {
+      std::vector<const detail::log_scope_node*> chain;
+      for( const detail::log_scope_node* n = s.get(); n; n = n->parent.get() )
+         chain.push_back( n );
+
+      mutable_variant_object result;
+      for( auto itr = chain.rbegin(); itr != chain.rend(); ++itr )
+         result( (*itr)->key, (*itr)->value );
+      return result;
+   }
+
+   log_scope_ptr log_scope::from_variant_object( const variant_object& o )
+   {
+      log_scope_ptr s;
+      for( auto itr = o.begin(); itr != o.end(); ++itr )
+         s = std::make_shared<detail::log_scope_node>( itr->key(), itr->value(), s );
+      return s;
+   }
+
+} // namespace fc
@@ -5,22 +5,57 @@
 #include <fc/thread/scoped_lock.hpp>
 #include <fc/log/appender.hpp>
 #include <fc/filesystem.hpp>
+#include <boost/atomic.hpp>
 #include <unordered_map>
 #include <string>
+#include <memory>
 
 namespace fc {
 
+    namespace detail
+    {
+       /** everything log() reads besides the level, never modified once it is published */
+       struct logger_state
+       {
+          logger_state()
+          :name( std::make_shared<const fc::string>() ),parent(nullptr),additivity(false){}
+
+          /** shared with the context of every message logged here */
+          std::shared_ptr<const fc::string> name;
+          logger                     parent;
+          bool                       additivity;
+          std::vector<appender::ptr> appenders;
+       };
+    }
+
     class logger::impl : public fc::retainable {
       public:
          impl()
-         :_parent(nullptr),_enabled(true),_additivity(false),_level(log_level::warn){}
-         fc::string       _name;
-         logger           _parent;
-         bool             _enabled;
-         bool             _additivity;
-         log_level        _level;
-
-         std::vector<appender::ptr> _appenders;
+         :_state( std::make_shared<detail::logger_state>() ),_level(log_level::warn){}
+
+         std::shared_ptr<const detail::logger_state> state()const
+         {
+            return std::atomic_load( &_state );
+         }
+
+         /**
+          *  Publishes a modified copy of the state, log statements in flight
+          *  keep using the copy they already loaded.
+          */
+         template<typename Modify>
+         void update( Modify&& modify )
+         {
+            scoped_lock<spin_lock> lock(_update_lock);
+            auto next = std::make_shared<detail::logger_state>( *state() );
+            modify( *next );
+            std::atomic_store( &_state, std::shared_ptr<const detail::logger_state>( std::move(next) ) );
+         }
+
+         std::shared_ptr<const detail::logger_state> _state;
+         /** serializes update() so that concurrent changes are not lost */
+         fc::spin_lock      _update_lock;
+         /** read on every log statement, written only by set_log_level */
+         boost::atomic<int> _level;
     };
 
 
@@ -32,8 +67,10 @@ namespace fc {
     logger::logger( const string& name, const logger& parent )
     :my( new impl() )
     {
-       my->_name = name;
-       my->_parent = parent;
+       my->update( [&]( detail::logger_state& s ) {
+          s.name   = std::make_shared<const fc::string>( name );
+          s.parent = parent;
+       });
     }
 
 
@@ -57,21 +94,26 @@ namespace fc {
     bool operator!=( const logger& l, std::nullptr_t ) { return l.my;  }
 
     bool logger::is_enabled( log_level e )const {
-       return e >= my->_level;
+       return e >= my->_level.load( boost::memory_order_relaxed );
     }
 
     void logger::log( log_message m ) {
-       m.get_context().append_context( my->_name );
+       auto state = my->state();
+       m = m.with_context( state->name );
 
-       for( auto itr = my->_appenders.begin(); itr != my->_appenders.end(); ++itr )
+       for( auto itr = state->appenders.begin(); itr != state->appenders.end(); ++itr )
           (*itr)->log( m );
 
-       if( my->_additivity && my->_parent != nullptr) {
-          my->_parent.log(m);
+       if( state->additivity && state->parent != nullptr) {
+          logger parent = state->parent;
+          parent.log(m);
        }
     }
-    void logger::set_name( const fc::string& n ) { my->_name = n; }
-    const fc::string& logger::name()const { return my->_name; }
+    void logger::set_name( const fc::string& n )
+    {
+       my->update( [&]( detail::logger_state& s ) { s.name = std::make_shared<const fc::string>( n ); } );
+    }
+    fc::string logger::name()const { return *my->state()->name; }
 
     extern bool do_default_config;
 
@@ -82,20 +124,53 @@ namespace fc {
       return lm;
     }
 
+    /** guards get_logger_map() */
+    static fc::spin_lock& logger_spinlock() {
+       static fc::spin_lock lock;
+       return lock;
+    }
+
     logger logger::get( const fc::string& s ) {
-       static fc::spin_lock logger_spinlock;
-       scoped_lock<spin_lock> lock(logger_spinlock);
+       scoped_lock<spin_lock> lock(logger_spinlock());
        return get_logger_map()[s];
     }
 
-    logger  logger::get_parent()const { return my->_parent; }
-    logger& logger::set_parent(const logger& p) { my->_parent = p; return *this; }
+    void reset_loggers() {
+       scoped_lock<spin_lock> lock(logger_spinlock());
+       auto& lm = get_logger_map();
+       for( auto itr = lm.begin(); itr != lm.end(); ++itr )
+          itr->second.reset();
+    }
 
-    log_level logger::get_log_level()const { return my->_level; }
-    logger& logger::set_log_level(log_level ll) { my->_level = ll; return *this; }
+    logger& logger::get_default() {
+       static logger* default_logger = new logger( get( "default" ) );
+       return *default_logger;
+    }
+
+    logger  logger::get_parent()const { return my->state()->parent; }
+    logger& logger::set_parent(const logger& p)
+    {
+       my->update( [&]( detail::logger_state& s ) { s.parent = p; } );
+       return *this;
+    }
+
+    log_level logger::get_log_level()const { return log_level( my->_level.load( boost::memory_order_relaxed ) ); }
+    logger& logger::set_log_level(log_level ll) { my->_level.store( ll, boost::memory_order_relaxed ); return *this; }
 
     void logger::add_appender( const fc::shared_ptr<appender>& a )
-    { my->_appenders.push_back(a); }
+    {
+       my->update( [&]( detail::logger_state& s ) { s.appenders.push_back(a); } );
+    }
+
+    void logger::reset()
+    {
+       my->_level.store( log_level::warn, boost::memory_order_relaxed );
+       my->update( []( detail::logger_state& s ) {
+          s.parent     = nullptr;
+          s.additivity = false;
+          s.appenders.clear();
+       });
+    }
     
 
 } // namespace fc
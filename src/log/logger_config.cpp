@@ -6,12 +6,14 @@
 #include <string>
 #include <fc/log/console_appender.hpp>
 #include <fc/log/file_appender.hpp>
+#include <fc/log/async_appender.hpp>
+#include <fc/log/binary_appender.hpp>
 #include <fc/reflect/variant.hpp>
 #include <fc/exception/exception.hpp>
 #include <fc/io/stdio.hpp>
 
 namespace fc {
-   extern std::unordered_map<std::string,logger>& get_logger_map();
+   extern void reset_loggers();
    extern std::unordered_map<std::string,appender::ptr>& get_appender_map();
    logger_config& logger_config::add_appender( const string& s ) { appenders.push_back(s); return *this; }
 
@@ -24,8 +26,15 @@ namespace fc {
       try {
       static bool reg_console_appender = appender::register_appender<console_appender>( "console" );
       static bool reg_file_appender = appender::register_appender<file_appender>( "file" );
-      get_logger_map().clear();
+      static bool reg_async_appender = appender::register_appender<async_appender>( "async" );
+      static bool reg_binary_appender = appender::register_appender<binary_appender>( "binary" );
+      // report drops to the appenders that are about to be replaced
+      flush_suppressed_log_messages();
+      // loggers are reset rather than dropped so that handles cached by the
+      // log macros keep referring to the reconfigured logger
+      reset_loggers();
       get_appender_map().clear();
+      configure_log_limits( cfg.limits );
 
       //slog( "\n%s", fc::json::to_pretty_string(cfg).c_str() );
       for( size_t i = 0; i < cfg.appenders.size(); ++i ) {
@@ -47,8 +56,8 @@ namespace fc {
             auto ap = appender::get( *a );
             if( ap ) { lgr.add_appender(ap); }
          }
-         return reg_console_appender || reg_file_appender;
       }
+      return reg_console_appender || reg_file_appender || reg_async_appender || reg_binary_appender;
       } catch ( exception& e )
       {
          fc::cerr<<e.to_detail_string()<<"\n";
@@ -5,6 +5,16 @@
 #include <fc/log/logger.hpp>
 #include <fc/io/stdio.hpp>
 #include <fc/exception/exception.hpp>
+#include <fc/filesystem.hpp>
+#include <fc/io/fstream.hpp>
+
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
 
 namespace fc {
 
@@ -57,10 +67,98 @@ namespace fc {
     fc::asio::tcp::connect(my->_sock, fc::asio::tcp::endpoint( boost::asio::ip::address_v4(e.get_address()), e.port() ) ); 
   }
 
+  void tcp_socket::set_no_delay( bool enable ) {
+    my->_sock.set_option( boost::asio::ip::tcp::no_delay(enable) );
+  }
+  void tcp_socket::set_keep_alive( bool enable ) {
+    my->_sock.set_option( boost::asio::socket_base::keep_alive(enable) );
+  }
+  void tcp_socket::set_send_buffer_size( size_t s ) {
+    my->_sock.set_option( boost::asio::socket_base::send_buffer_size(s) );
+  }
+  void tcp_socket::set_receive_buffer_size( size_t s ) {
+    my->_sock.set_option( boost::asio::socket_base::receive_buffer_size(s) );
+  }
+
+#if defined(__linux__)
+  uint64_t tcp_socket::send_file( const fc::path& p, uint64_t offset, uint64_t len ) {
+    struct file_handle {
+      file_handle( int f ):fd(f){}
+      ~file_handle() { if( fd >= 0 ) ::close(fd); }
+      int fd;
+    } file( ::open( p.string().c_str(), O_RDONLY ) );
+    if( file.fd < 0 )
+      FC_THROW_EXCEPTION( file_not_found_exception, "unable to open ${path}: ${message}", 
+                          ("path",p)("message",strerror(errno)) );
+
+    // sendfile reports EAGAIN rather than blocking, asio already relies on the
+    // descriptor being non-blocking for its async operations
+    my->_sock.native_non_blocking(true);
+
+    off_t    pos  = offset;
+    uint64_t sent = 0;
+    while( sent < len ) {
+      size_t chunk = static_cast<size_t>( std::min<uint64_t>( len - sent, 0x7ffff000 ) );
+      ssize_t r = ::sendfile( my->_sock.native_handle(), file.fd, &pos, chunk );
+      if( r > 0 ) { 
+        sent += r; 
+        continue; 
+      }
+      if( r == 0 ) break; // end of file
+      if( errno == EINTR ) continue;
+      if( errno != EAGAIN && errno != EWOULDBLOCK )
+        FC_THROW_EXCEPTION( exception, "sendfile failed: ${message}", ("message", strerror(errno)) );
+
+      promise<void>::ptr prom(new promise<void>("tcp_socket::send_file"));
+      my->_sock.async_write_some( boost::asio::null_buffers(), 
+          [=]( const boost::system::error_code& ec, size_t ) { 
+             fc::asio::detail::error_handler( prom, ec ); 
+          });
+      prom->wait();
+    }
+    return sent;
+  }
+#else
+  uint64_t tcp_socket::send_file( const fc::path& p, uint64_t offset, uint64_t len ) {
+    fc::ifstream in( p, fc::ifstream::binary );
+    in.seekg( offset );
+
+    char     buf[64*1024];
+    uint64_t sent = 0;
+    try {
+      while( sent < len ) {
+        size_t r = in.readsome( buf, static_cast<size_t>( std::min<uint64_t>( len - sent, sizeof(buf) ) ) );
+        write( buf, r );
+        sent += r;
+      }
+    } catch ( const fc::eof_exception& ) {}
+    return sent;
+  }
+#endif
+
   class tcp_server::impl {
     public:
-      impl(uint16_t port):
-      _accept( fc::asio::default_io_service(), boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), port) ){
+      impl():
+      _accept( fc::asio::default_io_service() ),
+      _reuse_address(true),_reuse_port(false),
+      _backlog( boost::asio::socket_base::max_connections ){
+      }
+
+      void listen( uint16_t port ) {
+        if( _accept.is_open() ) _accept.close();
+        boost::asio::ip::tcp::endpoint ep(boost::asio::ip::tcp::v4(), port);
+        _accept.open( ep.protocol() );
+        _accept.set_option( boost::asio::ip::tcp::acceptor::reuse_address(_reuse_address) );
+        if( _reuse_port ) {
+#if defined(SO_REUSEPORT)
+          typedef boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT> reuse_port;
+          _accept.set_option( reuse_port(true) );
+#else
+          FC_THROW_EXCEPTION( exception, "SO_REUSEPORT is not supported on this platform" );
+#endif
+        }
+        _accept.bind( ep );
+        _accept.listen( _backlog );
       }
       ~impl(){
         try {
@@ -73,13 +171,15 @@ namespace fc {
       }
 
       boost::asio::ip::tcp::acceptor _accept;
+      bool                           _reuse_address;
+      bool                           _reuse_port;
+      int                            _backlog;
   };
   void tcp_server::close() {
-    if( my && my->_accept.is_open() ) my->_accept.close();
-    delete my; my = nullptr;
+    if( my->_accept.is_open() ) my->_accept.close();
   }
   tcp_server::tcp_server()
-  :my(nullptr) {
+  :my(new impl()) {
   }
   tcp_server::~tcp_server() {
     delete my;
@@ -90,17 +190,20 @@ namespace fc {
   {
     try
     {
-      FC_ASSERT( my != nullptr );
+      FC_ASSERT( my->_accept.is_open() );
       fc::asio::tcp::accept( my->_accept, s.my->_sock  ); 
     } FC_RETHROW_EXCEPTIONS( warn, "Unable to accept connection on socket." );
   }
 
   void tcp_server::listen( uint16_t port ) 
   {
-    if( my ) delete my;
-    my = new impl(port);
+    my->listen( port );
   }
 
+  void tcp_server::set_reuse_address( bool enable ) { my->_reuse_address = enable; }
+  void tcp_server::set_reuse_port( bool enable )    { my->_reuse_port = enable;    }
+  void tcp_server::set_accept_backlog( int backlog ) { my->_backlog = backlog;     }
+
 
 
 } // namespace fc 
@@ -3,6 +3,12 @@
 #include <fc/fwd_impl.hpp>
 #include <fc/asio.hpp>
 
+#if defined(__linux__)
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#endif
 
 namespace fc {
   
@@ -14,6 +20,27 @@ namespace fc {
       }
 
       boost::asio::ip::udp::socket _sock;
+
+      /**
+       *  Blocks the current fiber until the socket is readable, used when a
+       *  non-blocking batch call finds nothing to do.
+       */
+      void wait_readable() {
+        promise<void>::ptr p(new promise<void>("udp_socket::wait_readable"));
+        _sock.async_receive( boost::asio::null_buffers(),
+            [=]( const boost::system::error_code& ec, size_t ) { 
+               fc::asio::detail::error_handler( p, ec ); 
+            });
+        p->wait();
+      }
+      void wait_writable() {
+        promise<void>::ptr p(new promise<void>("udp_socket::wait_writable"));
+        _sock.async_send( boost::asio::null_buffers(),
+            [=]( const boost::system::error_code& ec, size_t ) { 
+               fc::asio::detail::error_handler( p, ec ); 
+            });
+        p->wait();
+      }
   };
 
   boost::asio::ip::udp::endpoint to_asio_ep( const fc::ip::endpoint& e ) {
@@ -84,6 +111,116 @@ namespace fc {
         throw;
     }
   }
+#if defined(__linux__)
+  /** the most datagrams handed to a single recvmmsg/sendmmsg call */
+  static const size_t max_batch_size = 64;
+
+  static void to_sockaddr( const fc::ip::endpoint& e, sockaddr_in& sa ) {
+    memset( &sa, 0, sizeof(sa) );
+    sa.sin_family      = AF_INET;
+    sa.sin_addr.s_addr = htonl( uint32_t(e.get_address()) );
+    sa.sin_port        = htons( e.port() );
+  }
+  static fc::ip::endpoint to_fc_ep( const sockaddr_in& sa ) {
+    return fc::ip::endpoint( ntohl(sa.sin_addr.s_addr), ntohs(sa.sin_port) );
+  }
+
+  size_t udp_socket::receive_many( datagram* msgs, size_t count ) {
+    count = std::min( count, max_batch_size );
+    if( !count ) return 0;
+
+    mmsghdr     hdrs[max_batch_size];
+    iovec       iovs[max_batch_size];
+    sockaddr_in addrs[max_batch_size];
+    memset( hdrs, 0, sizeof(mmsghdr)*count );
+    for( size_t i = 0; i < count; ++i ) {
+      iovs[i].iov_base             = msgs[i].data;
+      iovs[i].iov_len              = msgs[i].capacity;
+      hdrs[i].msg_hdr.msg_iov      = &iovs[i];
+      hdrs[i].msg_hdr.msg_iovlen   = 1;
+      hdrs[i].msg_hdr.msg_name     = &addrs[i];
+      hdrs[i].msg_hdr.msg_namelen  = sizeof(addrs[i]);
+    }
+
+    while( true ) {
+      int r = recvmmsg( my->_sock.native_handle(), hdrs, count, MSG_DONTWAIT, nullptr );
+      if( r > 0 ) {
+        for( int i = 0; i < r; ++i ) {
+          msgs[i].size      = hdrs[i].msg_len;
+          msgs[i].endpoint  = to_fc_ep( addrs[i] );
+          msgs[i].truncated = (hdrs[i].msg_hdr.msg_flags & MSG_TRUNC) != 0;
+        }
+        return r;
+      }
+      if( r < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR )
+        FC_THROW_EXCEPTION( exception, "recvmmsg failed: ${message}", ("message", strerror(errno)) );
+      if( r < 0 && errno == EINTR ) continue;
+      my->wait_readable();
+    }
+  }
+
+  size_t udp_socket::send_many( const datagram* msgs, size_t count ) {
+    mmsghdr     hdrs[max_batch_size];
+    iovec       iovs[max_batch_size];
+    sockaddr_in addrs[max_batch_size];
+
+    size_t sent = 0;
+    while( sent < count ) {
+      size_t batch = std::min( count - sent, max_batch_size );
+      memset( hdrs, 0, sizeof(mmsghdr)*batch );
+      for( size_t i = 0; i < batch; ++i ) {
+        const datagram& m = msgs[sent+i];
+        to_sockaddr( m.endpoint, addrs[i] );
+        iovs[i].iov_base             = m.data;
+        iovs[i].iov_len              = m.size;
+        hdrs[i].msg_hdr.msg_iov      = &iovs[i];
+        hdrs[i].msg_hdr.msg_iovlen   = 1;
+        hdrs[i].msg_hdr.msg_name     = &addrs[i];
+        hdrs[i].msg_hdr.msg_namelen  = sizeof(addrs[i]);
+      }
+
+      int r = sendmmsg( my->_sock.native_handle(), hdrs, batch, MSG_DONTWAIT );
+      if( r > 0 ) {
+        sent += r;
+        continue;
+      }
+      if( r < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR )
+        FC_THROW_EXCEPTION( exception, "sendmmsg failed: ${message}", ("message", strerror(errno)) );
+      if( r < 0 && errno == EINTR ) continue;
+      my->wait_writable();
+    }
+    return sent;
+  }
+#else
+  size_t udp_socket::receive_many( datagram* msgs, size_t count ) {
+    if( !count ) return 0;
+    msgs[0].size      = receive_from( msgs[0].data, msgs[0].capacity, msgs[0].endpoint );
+    msgs[0].truncated = false;
+
+    // only drain what is already queued, the synchronous receive_from below
+    // would otherwise block the whole thread on a blocking socket
+    size_t received = 1;
+    boost::system::error_code ec;
+    while( received < count ) {
+      if( !my->_sock.available( ec ) || ec ) break;
+      boost::asio::ip::udp::endpoint from;
+      size_t r = my->_sock.receive_from( boost::asio::buffer( msgs[received].data, msgs[received].capacity ), from, 0, ec );
+      if( ec ) break;
+      msgs[received].size      = r;
+      msgs[received].endpoint  = to_fc_ep(from);
+      msgs[received].truncated = false;
+      ++received;
+    }
+    return received;
+  }
+
+  size_t udp_socket::send_many( const datagram* msgs, size_t count ) {
+    for( size_t i = 0; i < count; ++i )
+      send_to( msgs[i].data, msgs[i].size, msgs[i].endpoint );
+    return count;
+  }
+#endif
+
   void   udp_socket::close() {
     //my->_sock.cancel(); 
     my->_sock.close();
@@ -104,9 +241,43 @@ namespace fc {
   {
     my->_sock.set_option( boost::asio::ip::udp::socket::reuse_address(s) );
   }
+  void   udp_socket::set_reuse_port( bool s )
+  {
+#if defined(SO_REUSEPORT)
+    typedef boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT> reuse_port;
+    my->_sock.set_option( reuse_port(s) );
+#else
+    FC_THROW_EXCEPTION( exception, "SO_REUSEPORT is not supported on this platform" );
+#endif
+  }
   void   udp_socket::join_multicast_group( const fc::ip::address& a )
   {
     my->_sock.set_option( boost::asio::ip::multicast::join_group( boost::asio::ip::address_v4(a) ) );
   }
 
+
+  udp_datagram_batch::udp_datagram_batch( size_t count, size_t max_datagram_size )
+  :_max_datagram_size(max_datagram_size),_storage( count * max_datagram_size ),_msgs( count )
+  {
+    reset();
+  }
+
+  void udp_datagram_batch::reset()
+  {
+    for( size_t i = 0; i < _msgs.size(); ++i )
+      _msgs[i] = udp_socket::datagram( _storage.data() + i*_max_datagram_size, _max_datagram_size );
+  }
+
+  std::vector<udp_socket> open_reuse_port_group( const fc::ip::endpoint& ep, size_t count )
+  {
+    std::vector<udp_socket> socks(count);
+    for( size_t i = 0; i < count; ++i )
+    {
+      socks[i].open();
+      socks[i].set_reuse_port(true);
+      socks[i].bind(ep);
+    }
+    return socks;
+  }
+
 }
@@ -0,0 +1,435 @@
+#include <fc/rpc/binary_connection.hpp>
+#include <fc/io/raw_variant.hpp>
+#include <fc/compress/lz4.hpp>
+#include <boost/unordered_map.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/thread/scoped_lock.hpp>
+#include <fc/thread/mutex.hpp>
+#include <fc/log/logger.hpp>
+#include <string>
+
+namespace fc { namespace rpc {
+
+   namespace detail
+   {
+      /**
+       *  Every frame on the wire is a uint32_t byte count followed by a
+       *  binary_message packed with fc::raw.  If the high bit of the count is
+       *  set the message is compressed with lz4_compress.
+       */
+      struct binary_message
+      {
+         enum message_type
+         {
+            call       = 0, ///< data is a packed variant holding variants or a variant_object
+            raw_call   = 1, ///< data is passed to a raw_method unchanged
+            notice     = 2, ///< same as call, but no response is sent
+            result     = 3, ///< data is a packed variant, or raw bytes in response to a raw_call
+            error      = 4  ///< data is a packed variant holding the fc::exception
+         };
+
+         binary_message():type(call),id(0){}
+         binary_message( uint8_t t, uint64_t i, fc::string m = fc::string(), std::vector<char> d = std::vector<char>() )
+         :type(t),id(i),method(fc::move(m)),data(fc::move(d)){}
+
+         uint8_t             type;
+         unsigned_int        id;
+         fc::string          method;
+         std::vector<char>   data;
+      };
+
+      /** frames larger than this are treated as a protocol error */
+      static const uint32_t max_frame_size = MAX_ARRAY_ALLOC_SIZE;
+      static const uint32_t compressed_frame = 0x80000000;
+   }
+
+}} // fc::rpc
+
+FC_REFLECT( fc::rpc::detail::binary_message, (type)(id)(method)(data) )
+
+namespace fc { namespace rpc {
+
+   namespace detail
+   {
+      class binary_connection_impl
+      {
+         public:
+            binary_connection_impl( fc::buffered_istream_ptr&& in, fc::buffered_ostream_ptr&& out )
+            :_in(fc::move(in)),_out(fc::move(out)),_eof(false),_next_id(0),_flush_scheduled(false),
+             _compression_threshold(0),_logger("binary_connection"){}
+
+            fc::buffered_istream_ptr                                              _in;
+            fc::buffered_ostream_ptr                                              _out;
+
+            fc::future<void>                                                      _done;
+            bool                                                                  _eof;
+
+            uint64_t                                                              _next_id;
+            boost::unordered_map<uint64_t, fc::promise<variant>::ptr>             _awaiting;
+            boost::unordered_map<uint64_t, fc::promise<std::vector<char>>::ptr>   _awaiting_raw;
+            boost::unordered_map<std::string, binary_connection::method>            _methods;
+            boost::unordered_map<std::string, binary_connection::named_param_method> _named_param_methods;
+            boost::unordered_map<std::string, binary_connection::raw_method>        _raw_methods;
+
+            fc::mutex                                                             _write_mutex;
+            bool                                                                  _flush_scheduled;
+            uint32_t                                                              _compression_threshold;
+
+            logger                                                                _logger;
+
+            void write_message( const binary_message& msg )
+            {
+               fc::datastream<size_t> ps;
+               fc::raw::pack( ps, msg );
+               FC_ASSERT( ps.tellp() <= max_frame_size, "message too large", ("size",ps.tellp()) );
+
+               uint32_t size = static_cast<uint32_t>(ps.tellp());
+               std::vector<char> frame( sizeof(size) + size );
+               memcpy( frame.data(), &size, sizeof(size) );
+               fc::datastream<char*> ds( frame.data() + sizeof(size), size );
+               fc::raw::pack( ds, msg );
+
+               if( _compression_threshold && size >= _compression_threshold )
+               {
+                  std::vector<char> compressed( sizeof(size) + sizeof(uint32_t) + lz4_compress_bound( size ) );
+                  memcpy( compressed.data() + sizeof(size), &size, sizeof(size) );
+                  size_t stored = sizeof(uint32_t) + lz4_compress( frame.data() + sizeof(size), size,
+                                                                   compressed.data() + 2*sizeof(size) );
+                  // only worth sending if it saved something
+                  if( stored < size )
+                  {
+                     uint32_t flagged = uint32_t(stored) | compressed_frame;
+                     memcpy( compressed.data(), &flagged, sizeof(flagged) );
+                     compressed.resize( sizeof(size) + stored );
+                     frame.swap( compressed );
+                  }
+               }
+
+               fc::scoped_lock<fc::mutex> lock(_write_mutex);
+               _out->write( frame.data(), frame.size() );
+            }
+
+            /** sends a request and flushes immediately */
+            void send_request( const binary_message& msg )
+            {
+               write_message( msg );
+               fc::scoped_lock<fc::mutex> lock(_write_mutex);
+               _out->flush();
+            }
+
+            /**
+             *  Sends a response, flushing is deferred until every message that
+             *  is ready to be handled has had a chance to write its response.
+             */
+            void send_response( const binary_message& msg )
+            {
+               write_message( msg );
+               if( _flush_scheduled ) return;
+               _flush_scheduled = true;
+               fc::async( [=](){
+                  _flush_scheduled = false;
+                  fc::scoped_lock<fc::mutex> lock(_write_mutex);
+                  _out->flush();
+               }, "binary_connection::flush" );
+            }
+
+            std::vector<char> call_method( const binary_message& msg )
+            {
+               if( msg.type == binary_message::raw_call )
+               {
+                  auto rmi = _raw_methods.find(msg.method);
+                  if( rmi == _raw_methods.end() )
+                     FC_THROW_EXCEPTION( exception, "Invalid Method '${method}'", ("method",msg.method));
+                  return rmi->second( msg.data );
+               }
+
+               variant params;
+               if( msg.data.size() )
+                  params = fc::raw::unpack<variant>( msg.data );
+
+               if( params.is_null() || params.is_array() )
+               {
+                  auto pmi = _methods.find(msg.method);
+                  if( pmi != _methods.end() )
+                     return fc::raw::pack( pmi->second( params.is_null() ? variants() : params.get_array() ) );
+               }
+               if( params.is_null() || params.is_object() )
+               {
+                  auto nmi = _named_param_methods.find(msg.method);
+                  if( nmi != _named_param_methods.end() )
+                     return fc::raw::pack( nmi->second( params.is_null() ? variant_object() : params.get_object() ) );
+               }
+               FC_THROW_EXCEPTION( exception, "Invalid method or params  '${method}'", ("method",msg.method));
+            }
+
+            void handle_response( const binary_message& msg )
+            {
+               uint64_t id = msg.id.value;
+               auto await = _awaiting.find(id);
+               if( await != _awaiting.end() )
+               {
+                  auto prom = await->second;
+                  _awaiting.erase(await);
+                  if( msg.type == binary_message::result )
+                     prom->set_value( fc::raw::unpack<variant>( msg.data ) );
+                  else
+                     prom->set_exception( unpack_exception( msg ) );
+                  return;
+               }
+               auto await_raw = _awaiting_raw.find(id);
+               if( await_raw != _awaiting_raw.end() )
+               {
+                  auto prom = await_raw->second;
+                  _awaiting_raw.erase(await_raw);
+                  if( msg.type == binary_message::result )
+                     prom->set_value( msg.data );
+                  else
+                     prom->set_exception( unpack_exception( msg ) );
+                  return;
+               }
+               fc_wlog( _logger, "response for unknown request id ${id}", ("id",id) );
+            }
+
+            fc::exception_ptr unpack_exception( const binary_message& msg )
+            {
+               try
+               {
+                  return fc::raw::unpack<variant>( msg.data ).as<exception>().dynamic_copy_exception();
+               }
+               catch ( fc::exception& e )
+               {
+                  fc_elog( _logger, "Error parsing exception: ${e}", ("e", e.to_detail_string() ) );
+                  return e.dynamic_copy_exception();
+               }
+            }
+
+            void handle_message( const binary_message& msg )
+            {
+               fc_dlog( _logger, "recv: ${type} ${id} ${method}", ("type",msg.type)("id",msg.id.value)("method",msg.method) );
+               try
+               {
+                  switch( msg.type )
+                  {
+                     case binary_message::call:
+                     case binary_message::raw_call:
+                     case binary_message::notice:
+                        try
+                        {
+                           auto result = call_method( msg );
+                           if( msg.type != binary_message::notice )
+                              send_response( binary_message( binary_message::result, msg.id.value, fc::string(), fc::move(result) ) );
+                        }
+                        catch ( fc::exception& e )
+                        {
+                           if( msg.type != binary_message::notice )
+                              send_response( binary_message( binary_message::error, msg.id.value, fc::string(), fc::raw::pack( variant(e) ) ) );
+                           else
+                              fc_wlog( _logger, "rpc exception: ${exception}", ("exception",e) );
+                        }
+                        return;
+                     case binary_message::result:
+                     case binary_message::error:
+                        handle_response( msg );
+                        return;
+                     default:
+                        FC_THROW_EXCEPTION( parse_error_exception, "Unknown message type ${t}", ("t", msg.type) );
+                  }
+               }
+               catch ( fc::exception& e ) // catch all other errors...
+               {
+                  fc_elog( _logger, "rpc exception: ${exception}", ("exception",e ));
+                  close(e.dynamic_copy_exception());
+               }
+            }
+
+            void read_loop()
+            {
+               try
+               {
+                  std::vector<char> frame;
+                  while( true )
+                  {
+                      uint32_t size = 0;
+                      _in->read( (char*)&size, sizeof(size) );
+                      bool compressed = (size & compressed_frame) != 0;
+                      size &= ~compressed_frame;
+                      FC_ASSERT( size <= max_frame_size, "message too large", ("size",size) );
+                      frame.resize( size );
+                      if( size ) _in->read( frame.data(), size );
+                      if( compressed )
+                      {
+                         FC_ASSERT( size >= sizeof(uint32_t), "compressed message without its size" );
+                         uint32_t plain_size = 0;
+                         memcpy( &plain_size, frame.data(), sizeof(plain_size) );
+                         FC_ASSERT( plain_size <= max_frame_size, "message too large", ("size",plain_size) );
+                         std::vector<char> plain( plain_size );
+                         size_t n = lz4_decompress( frame.data() + sizeof(plain_size), size - sizeof(plain_size),
+                                                    plain.data(), plain.size() );
+                         FC_ASSERT( n == plain_size, "corrupt compressed message" );
+                         frame.swap( plain );
+                      }
+
+                      auto msg = fc::raw::unpack<binary_message>( frame );
+                      fc::async( [=](){ handle_message( msg ); }, "binary_connection::handle_message" );
+                  }
+               }
+               catch ( eof_exception& eof )
+               {
+                  _eof = true;
+                  close( eof.dynamic_copy_exception() );
+               }
+               catch ( exception& e )
+               {
+                  close( e.dynamic_copy_exception() );
+               }
+               catch ( ... )
+               {
+                  close( fc::exception_ptr(new FC_EXCEPTION( unhandled_exception, "binary connection read error" )) );
+               }
+            }
+
+            void close( fc::exception_ptr e )
+            {
+               fc_dlog( _logger, "close ${reason}", ("reason", e->to_detail_string() ) );
+               for( auto itr = _awaiting.begin(); itr != _awaiting.end(); ++itr )
+                  itr->second->set_exception( e->dynamic_copy_exception() );
+               for( auto itr = _awaiting_raw.begin(); itr != _awaiting_raw.end(); ++itr )
+                  itr->second->set_exception( e->dynamic_copy_exception() );
+               _awaiting.clear();
+               _awaiting_raw.clear();
+            }
+
+            future<variant> call( const fc::string& method, const variant& params )
+            {
+               auto id = _next_id++;
+               fc::promise<variant>::ptr prom( new fc::promise<variant>("binary_connection::call") );
+               _awaiting[id] = prom;
+               send_request( binary_message( binary_message::call, id, method, fc::raw::pack( params ) ) );
+               return prom;
+            }
+      };
+   }//namespace detail
+
+   binary_connection::binary_connection( fc::buffered_istream_ptr in, fc::buffered_ostream_ptr out )
+   :my( new detail::binary_connection_impl(fc::move(in),fc::move(out)) )
+   {}
+
+   binary_connection::~binary_connection()
+   {
+      try
+      {
+         if( my->_done.valid() && !my->_done.ready() )
+         {
+            my->_done.cancel();
+            my->_done.wait();
+         }
+      }
+      catch ( fc::canceled_exception& ){} // expected exception
+      catch ( fc::eof_exception& ){} // expected exception
+      catch ( fc::exception& e )
+      {
+         // unhandled, unexpected exception cannot throw from destructor, so log it.
+         wlog( "${exception}", ("exception",e.to_detail_string()) );
+      }
+   }
+
+   fc::future<void> binary_connection::exec()
+   {
+      if( my->_done.valid() )
+      {
+         FC_THROW_EXCEPTION( assert_exception, "start should only be called once" );
+      }
+      return my->_done = fc::async( [=](){ my->read_loop(); } );
+   }
+
+   void binary_connection::add_method( const fc::string& name, method m )
+   {
+      my->_methods.emplace(std::pair<std::string,method>(name,fc::move(m)));
+   }
+   void binary_connection::add_named_param_method( const fc::string& name, named_param_method m )
+   {
+      my->_named_param_methods.emplace(std::pair<std::string,named_param_method>(name,fc::move(m)));
+   }
+   void binary_connection::add_raw_method( const fc::string& name, raw_method m )
+   {
+      my->_raw_methods.emplace(std::pair<std::string,raw_method>(name,fc::move(m)));
+   }
+   void binary_connection::remove_method( const fc::string& name )
+   {
+      my->_methods.erase(name);
+      my->_named_param_methods.erase(name);
+      my->_raw_methods.erase(name);
+   }
+
+   void binary_connection::notice( const fc::string& method )
+   {
+      my->send_request( detail::binary_message( detail::binary_message::notice, 0, method ) );
+   }
+   void binary_connection::notice( const fc::string& method, const variants& args )
+   {
+      my->send_request( detail::binary_message( detail::binary_message::notice, 0, method, fc::raw::pack( variant(args) ) ) );
+   }
+   void binary_connection::notice( const fc::string& method, const variant_object& named_args )
+   {
+      my->send_request( detail::binary_message( detail::binary_message::notice, 0, method, fc::raw::pack( variant(named_args) ) ) );
+   }
+
+   future<variant> binary_connection::async_call( const fc::string& method, const variant_object& named_args )
+   {
+      return my->call( method, variant(named_args) );
+   }
+   future<variant> binary_connection::async_call( const fc::string& method, const variants& args )
+   {
+      return my->call( method, variant(args) );
+   }
+   future<variant> binary_connection::async_call( const fc::string& method )
+   {
+      return my->call( method, variant() );
+   }
+   future<variant> binary_connection::async_call( const fc::string& method, const variant& a1 )
+   {
+      variants args(1);
+      args[0] = a1;
+      return my->call( method, variant(fc::move(args)) );
+   }
+   future<variant> binary_connection::async_call( const fc::string& method, const variant& a1, const variant& a2 )
+   {
+      variants args(2);
+      args[0] = a1;
+      args[1] = a2;
+      return my->call( method, variant(fc::move(args)) );
+   }
+   future<variant> binary_connection::async_call( const fc::string& method, const variant& a1, const variant& a2, const variant& a3 )
+   {
+      variants args(3);
+      args[0] = a1;
+      args[1] = a2;
+      args[2] = a3;
+      return my->call( method, variant(fc::move(args)) );
+   }
+
+   future<std::vector<char>> binary_connection::async_raw_call( const fc::string& method, const std::vector<char>& params )
+   {
+      auto id = my->_next_id++;
+      fc::promise<std::vector<char>>::ptr prom( new fc::promise<std::vector<char>>("binary_connection::raw_call") );
+      my->_awaiting_raw[id] = prom;
+      my->send_request( detail::binary_message( detail::binary_message::raw_call, id, method, params ) );
+      return prom;
+   }
+
+   void binary_connection::set_compression_threshold( uint32_t min_size )
+   {
+      my->_compression_threshold = min_size;
+   }
+
+   logger binary_connection::get_logger()const
+   {
+      return my->_logger;
+   }
+
+   void   binary_connection::set_logger( const logger& l )
+   {
+      my->_logger = l;
+   }
+
+}}
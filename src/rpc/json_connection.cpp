@@ -5,6 +5,7 @@
 #include <fc/thread/scoped_lock.hpp>
 #include <fc/thread/mutex.hpp>
 #include <fc/log/logger.hpp>
+#include <algorithm>
 #include <string>
 
 namespace fc { namespace rpc {
@@ -15,7 +16,15 @@ namespace fc { namespace rpc {
       {
          public:
             json_connection_impl( fc::buffered_istream_ptr&& in, fc::buffered_ostream_ptr&& out )
-            :_in(fc::move(in)),_out(fc::move(out)),_eof(false),_next_id(0),_logger("json_connection"){}
+            :_in(fc::move(in)),_out(fc::move(out)),_eof(false),_next_id(0),
+             _max_concurrent_calls(0),_active_calls(0),_next_worker(0),_flush_scheduled(false),
+             _logger("json_connection"){}
+
+            ~json_connection_impl()
+            {
+               for( auto itr = _workers.begin(); itr != _workers.end(); ++itr )
+                  (*itr)->quit();
+            }
 
             fc::buffered_istream_ptr                                              _in;
             fc::buffered_ostream_ptr                                              _out;
@@ -28,11 +37,77 @@ namespace fc { namespace rpc {
             boost::unordered_map<std::string, json_connection::method>            _methods;
             boost::unordered_map<std::string, json_connection::named_param_method> _named_param_methods;
 
+            /** 0 means no limit */
+            uint32_t                                                              _max_concurrent_calls;
+            uint32_t                                                              _active_calls;
+            fc::promise<void>::ptr                                                _call_slot_freed;
+
+            std::vector<std::unique_ptr<fc::thread>>                              _workers;
+            uint32_t                                                              _next_worker;
+
             fc::mutex                                                             _write_mutex;
+            bool                                                                  _flush_scheduled;
+            /** handler and flush tasks that refer to this object, see spawn() */
+            std::vector<fc::future<void>>                                         _tasks;
             //std::function<void(fc::exception_ptr)>                                _on_close;
 
             logger                                                                _logger;
 
+            /**
+             *  Responses are written to the buffered stream without flushing, the
+             *  flush is deferred until every message that is ready to be handled
+             *  has had a chance to write its response, so a burst of requests
+             *  results in a single write to the underlying stream.
+             */
+            void schedule_flush()
+            {
+               if( _flush_scheduled ) return;
+               _flush_scheduled = true;
+               spawn( [=](){ flush_responses(); }, "json_connection::flush" );
+            }
+
+            /**
+             *  Starts @param f on this thread and keeps its future, so that the
+             *  connection is not destroyed while the task can still run.
+             */
+            template<typename Functor>
+            void spawn( Functor&& f, const char* desc )
+            {
+               _tasks.erase( std::remove_if( _tasks.begin(), _tasks.end(),
+                                             []( const fc::future<void>& t ){ return t.ready(); } ),
+                             _tasks.end() );
+               _tasks.push_back( fc::async( fc::forward<Functor>(f), desc ) );
+            }
+
+            /** cancels and waits for every task from spawn(), then flushes what they wrote */
+            void stop_tasks()
+            {
+               // a task that is still running may spawn a flush before it ends
+               while( _tasks.size() )
+               {
+                  std::vector<fc::future<void>> tasks;
+                  tasks.swap( _tasks );
+                  for( auto itr = tasks.begin(); itr != tasks.end(); ++itr )
+                     if( !itr->ready() ) itr->cancel();
+                  for( auto itr = tasks.begin(); itr != tasks.end(); ++itr )
+                  {
+                     try { itr->wait(); }
+                     catch ( const fc::exception& ) {} // canceled, or already reported by the task
+                  }
+               }
+               try {
+                  fc::scoped_lock<fc::mutex> lock(_write_mutex);
+                  _out->flush();
+               } catch ( const fc::exception& ) {} // the peer may already be gone
+            }
+
+            void flush_responses()
+            {
+               _flush_scheduled = false;
+               fc::scoped_lock<fc::mutex> lock(_write_mutex);
+               _out->flush();
+            }
+
             void send_result( variant id, variant result )
             {
                {
@@ -43,7 +118,7 @@ namespace fc { namespace rpc {
                  json::to_stream( *_out, result);
                  *_out << "}\n";
                }
-               _out->flush();
+               schedule_flush();
             }
             void send_error( variant id, fc::exception& e )
             {
@@ -51,19 +126,152 @@ namespace fc { namespace rpc {
                  fc::scoped_lock<fc::mutex> lock(_write_mutex);
                  *_out << "{\"id\":";
                  json::to_stream( *_out, id  );
-                 *_out << ",\"error\":{\"message\":";
-                 json::to_stream( *_out, fc::string(e.what()) );
-                 *_out <<",\"code\":0,\"data\":";
-                 json::to_stream( *_out, variant(e));
-                 *_out << "}}\n";
+                 *_out << ",\"error\":";
+                 json::to_stream( *_out, error_object(e) );
+                 *_out << "}\n";
+               }
+               fc_wlog( _logger, "exception: ${except}", ("except", e.to_detail_string()) );
+               schedule_flush();
+            }
+            /** writes a batch response array or a lone error object */
+            void send_variant( const variant& v )
+            {
+               {
+                 fc::scoped_lock<fc::mutex> lock(_write_mutex);
+                 json::to_stream( *_out, v );
+                 *_out << "\n";
+               }
+               schedule_flush();
+            }
+
+            static variant_object invalid_request()
+            {
+               return mutable_variant_object( "id", variant() )
+                     ( "error", mutable_variant_object( "message", "Invalid Request" )( "code", -32600 ) );
+            }
+
+            static variant_object error_object( fc::exception& e )
+            {
+               return mutable_variant_object( "message", fc::string(e.what()) )
+                                            ( "code", 0 )
+                                            ( "data", variant(e) );
+            }
+
+            /**
+             *  Runs @param m on one of the worker threads if any have been
+             *  configured, otherwise calls it directly.
+             */
+            template<typename Method, typename Params>
+            variant invoke( const Method& m, const Params& params )
+            {
+               if( _workers.empty() )
+                  return m( params );
+
+               fc::thread& worker = *_workers[_next_worker++ % _workers.size()];
+               return worker.async( [m,params](){ return m( params ); }, "json_connection::invoke" ).wait();
+            }
+
+            /**
+             *  Looks up and calls the method named by @param obj
+             *
+             *  @throws fc::exception if the method or params are invalid or the method throws
+             */
+            variant call_method( const variant_object& obj, const fc::string& method_name )
+            {
+               auto p = obj.find("params");
+               if( p == obj.end() )
+               {
+                  auto pmi = _methods.find(method_name);
+                  auto nmi = _named_param_methods.find(method_name);
+                  if( pmi != _methods.end()  )
+                  {
+                      return invoke( pmi->second, variants() );
+                  }
+                  else if( nmi != _named_param_methods.end() )
+                  {
+                      return invoke( nmi->second, variant_object() );
+                  }
+                  else // invalid method
+                  {
+                     FC_THROW_EXCEPTION( exception, "Invalid Method '${method}'", ("method",method_name));
+                  }
+               }
+               else if( p->value().is_array() )
+               {
+                  auto pmi = _methods.find(method_name);
+                  if( pmi != _methods.end()  )
+                  {
+                      return invoke( pmi->second, p->value().get_array() );
+                  }
+                  else // invalid method / param combo
+                  {
+                     FC_THROW_EXCEPTION( exception, "Invalid method or params  '${method}'", 
+                                         ("method",method_name));
+                  }
+               
+               }
+               else if( p->value().is_object() )
+               {
+                  auto nmi = _named_param_methods.find(method_name);
+                  if( nmi != _named_param_methods.end() )
+                  {
+                      return invoke( nmi->second, p->value().get_object() );
+                  }
+                  else // invalid method / param combo?
+                  {
+                     FC_THROW_EXCEPTION( exception, "Invalid method or params  '${method}'", 
+                                         ("method",method_name));
+                  }
+               }
+               else // invalid params
+               {
+                   FC_THROW_EXCEPTION( exception, "Invalid Params for method ${method}", 
+                                           ("method",method_name));
+               }
+            }
+
+            void handle_response( const variant_object& obj, const variant& response_id )
+            {
+               uint64_t id = response_id.as_int64();
+               auto await = _awaiting.find(id);
+               if( await != _awaiting.end() )
+               {
+                  auto r = obj.find("result");
+                  auto e = obj.find("error");
+                  if( r != obj.end() )
+                  {
+                     await->second->set_value( r->value() ); 
+                  }
+                  else if( e != obj.end() )
+                  {
+                    try
+                    {
+                       auto err = e->value().get_object();
+                       auto data = err.find( "data" );
+                       if( data != err.end() )
+                       {
+                          fc_dlog( _logger, "exception: ${except}", ("except", data->value() ) );
+                          await->second->set_exception( data->value().as<exception>().dynamic_copy_exception() );  
+                       }
+                       else
+                          await->second->set_exception( exception_ptr(new FC_EXCEPTION( exception, "${error}", ("error",e->value()) ) ) );
+                    } 
+                    catch ( fc::exception& e )
+                    {
+                      elog( "Error parsing exception: ${e}", ("e", e.to_detail_string() ) );
+                      await->second->set_exception( e.dynamic_copy_exception() );
+                    }
+                  }
+                  else // id found without error, result, nor method field
+                  {
+                     fc_wlog( _logger, "no error or result specified in '${message}'", ("message",obj) );
+                  }
                }
-               wlog(  "exception: ${except}", ("except", variant(e)) );
-               _out->flush();
             }
 
             void handle_message( const variant_object& obj )
             {
-              wlog(  "recv: ${msg}", ("msg", obj) );
+               fc_dlog( _logger, "recv: ${msg}", ("msg", obj) );
                try 
                {
                   auto m = obj.find("method");
@@ -72,57 +280,7 @@ namespace fc { namespace rpc {
                   {
                      try
                      {
-                        auto p = obj.find("params");
-                        variant result;
-                        if( p == obj.end() )
-                        {
-                           auto pmi = _methods.find(m->value().as_string());
-                           auto nmi = _named_param_methods.find(m->value().as_string());
-                           if( pmi != _methods.end()  )
-                           {
-                               result = pmi->second( variants() );
-                           }
-                           else if( nmi != _named_param_methods.end() )
-                           {
-                               result = nmi->second( variant_object() );
-                           }
-                           else // invalid method
-                           {
-                              FC_THROW_EXCEPTION( exception, "Invalid Method '${method}'", ("method",m->value().as_string()));
-                           }
-                        }
-                        else if( p->value().is_array() )
-                        {
-                           auto pmi = _methods.find(m->value().as_string());
-                           if( pmi != _methods.end()  )
-                           {
-                               result = pmi->second( p->value().get_array() );
-                           }
-                           else // invalid method / param combo
-                           {
-                              FC_THROW_EXCEPTION( exception, "Invalid method or params  '${method}'", 
-                                                  ("method",m->value().as_string()));
-                           }
-                        
-                        }
-                        else if( p->value().is_object() )
-                        {
-                           auto nmi = _named_param_methods.find(m->value().as_string());
-                           if( nmi != _named_param_methods.end() )
-                           {
-                               result = nmi->second( p->value().get_object() );
-                           }
-                           else // invalid method / param combo?
-                           {
-                              FC_THROW_EXCEPTION( exception, "Invalid method or params  '${method}'", 
-                                                  ("method",m->value().as_string()));
-                           }
-                        }
-                        else // invalid params
-                        {
-                            FC_THROW_EXCEPTION( exception, "Invalid Params for method ${method}", 
-                                                    ("method",m->value().as_string()));
-                        }
+                        variant result = call_method( obj, m->value().as_string() );
                         if( i != obj.end() )
                         {
                            send_result( i->value(), result );
@@ -142,41 +300,7 @@ namespace fc { namespace rpc {
                   }
                   else if( i != obj.end() )
                   {
-                     uint64_t id = i->value().as_int64();
-                     auto await = _awaiting.find(id);
-                     if( await != _awaiting.end() )
-                     {
-                        auto r = obj.find("result");
-                        auto e = obj.find("error");
-                        if( r != obj.end() )
-                        {
-                           await->second->set_value( r->value() ); 
-                        }
-                        else if( e != obj.end() )
-                        {
-                          try
-                          {
-                             auto err = e->value().get_object();
-                             auto data = err.find( "data" );
-                             if( data != err.end() )
-                             {
-                                wlog(  "exception: ${except}", ("except", data->value() ) );
-                                await->second->set_exception( data->value().as<exception>().dynamic_copy_exception() );  
-                             }
-                             else
-                                await->second->set_exception( exception_ptr(new FC_EXCEPTION( exception, "${error}", ("error",e->value()) ) ) );
-                          } 
-                          catch ( fc::exception& e )
-                          {
-                            elog( "Error parsing exception: ${e}", ("e", e.to_detail_string() ) );
-                            await->second->set_exception( e.dynamic_copy_exception() );
-                          }
-                        }
-                        else // id found without error, result, nor method field
-                        {
-                           fc_wlog( _logger, "no error or result specified in '${message}'", ("message",obj) );
-                        }
-                     }
+                     handle_response( obj, i->value() );
                   }
                   else // no method nor request id... invalid message
                   {
@@ -191,41 +315,135 @@ namespace fc { namespace rpc {
                }
             }
 
+            /**
+             *  Handles a JSON-RPC 2.0 batch, every call in the batch is dispatched
+             *  concurrently and the responses are written back as a single array
+             *  once all of them have completed.  Notifications produce no response
+             *  and no array is written if the batch contained only notifications.
+             */
+            void handle_batch( const variants& batch )
+            {
+               fc_dlog( _logger, "recv batch: ${msg}", ("msg", batch) );
+               if( batch.empty() )
+               {
+                  // JSON-RPC 2.0 answers an empty batch with a single error, not an array
+                  send_variant( invalid_request() );
+                  return;
+               }
+               variants                         responses;
+               std::vector<fc::future<variant>> pending;
+               pending.reserve( batch.size() );
+               try 
+               {
+                  for( auto itr = batch.begin(); itr != batch.end(); ++itr )
+                  {
+                     if( !itr->is_object() )
+                     {
+                        responses.push_back( invalid_request() );
+                        continue;
+                     }
+
+                     const variant_object& obj = itr->get_object();
+                     if( obj.find("method") == obj.end() )
+                     {
+                        auto i = obj.find("id");
+                        if( i != obj.end() )
+                           handle_response( obj, i->value() );
+                        continue;
+                     }
+                     pending.push_back( fc::async( [=]() -> variant {
+                        auto i = obj.find("id");
+                        try 
+                        {
+                           variant result = call_method( obj, obj["method"].as_string() );
+                           if( i == obj.end() ) return variant();
+                           return mutable_variant_object( "id", i->value() )( "result", fc::move(result) );
+                        }
+                        catch ( fc::exception& e )
+                        {
+                           if( i == obj.end() ) 
+                           {
+                              fc_wlog( _logger, "json rpc exception: ${exception}", ("exception",e) );
+                              return variant();
+                           }
+                           return mutable_variant_object( "id", i->value() )( "error", error_object(e) );
+                        }
+                     }, "json_connection::batch_call" ) );
+                  }
+
+                  for( auto itr = pending.begin(); itr != pending.end(); ++itr )
+                  {
+                     variant response = itr->wait();
+                     if( !response.is_null() )
+                        responses.push_back( fc::move(response) );
+                  }
+                  if( responses.size() )
+                     send_variant( responses );
+               }
+               catch ( fc::exception& e )
+               {
+                  fc_elog( _logger, "json rpc exception: ${exception}", ("exception",e ));
+                  close(e.dynamic_copy_exception());   
+               }
+            }
+
+            void handle_variant( const variant& v )
+            {
+               if( v.is_array() )
+                  handle_batch( v.get_array() );
+               else
+                  handle_message( v.get_object() );
+            }
+
+            void call_complete()
+            {
+               --_active_calls;
+               if( _call_slot_freed )
+               {
+                  auto slot_freed = _call_slot_freed;
+                  _call_slot_freed.reset();
+                  slot_freed->set_value();
+               }
+            }
+
             void read_loop()
             {
                try 
                {
-                  fc::string line;
                   while( true )
                   {
                       variant v = json::from_stream(*_in);
-                      ///ilog( "input: ${in}", ("in", v ) );
-                      wlog(  "recv: ${line}", ("line", line) );
-                      fc::async([=](){ handle_message(v.get_object()); });
+                      while( _max_concurrent_calls && _active_calls >= _max_concurrent_calls )
+                      {
+                         _call_slot_freed = fc::promise<void>::ptr( new fc::promise<void>("json_connection::call_slot") );
+                         _call_slot_freed->wait();
+                      }
+                      ++_active_calls;
+                      spawn( [=](){ 
+                         try { handle_variant( v ); } 
+                         catch ( ... ) { call_complete(); throw; }
+                         call_complete();
+                      }, "json_connection::handle_message" );
                   } 
                } 
                catch ( eof_exception& eof ) 
                { 
                   _eof = true; 
-               wlog( "close" );
                   close( eof.dynamic_copy_exception() );
                }
                catch ( exception& e )
                {
-               wlog( "close" );
                   close( e.dynamic_copy_exception() );
                }
                catch ( ... )
                {
-               wlog( "close" );
                   close( fc::exception_ptr(new FC_EXCEPTION( unhandled_exception, "json connection read error" )) );
                }
-               wlog( "close" );
             }
 
             void close( fc::exception_ptr e )
             {
-               wlog( "close ${reason}", ("reason", e->to_detail_string() ) );
+               fc_dlog( _logger, "close ${reason}", ("reason", e->to_detail_string() ) );
                for( auto itr = _awaiting.begin(); itr != _awaiting.end(); ++itr )
                {
                   itr->second->set_exception( e->dynamic_copy_exception() );
@@ -255,6 +473,8 @@ namespace fc { namespace rpc {
          // unhandled, unexpected exception cannot throw from destructor, so log it.
          wlog( "${exception}", ("exception",e.to_detail_string()) );
       }
+      // the read loop is gone, so no new tasks can be spawned
+      my->stop_tasks();
    }
 
    fc::future<void> json_connection::exec()
@@ -264,10 +484,24 @@ namespace fc { namespace rpc {
          FC_THROW_EXCEPTION( assert_exception, "start should only be called once" );
       }
 
-      wlog(  "EXEC!!!\n" );
       return my->_done = fc::async( [=](){ my->read_loop(); } );
    }
 
+   void json_connection::set_max_concurrent_calls( uint32_t max_calls )
+   {
+      my->_max_concurrent_calls = max_calls;
+   }
+
+   void json_connection::set_worker_threads( uint32_t num_threads )
+   {
+      FC_ASSERT( !my->_done.valid(), "worker threads must be configured before calling exec()" );
+      for( auto itr = my->_workers.begin(); itr != my->_workers.end(); ++itr )
+         (*itr)->quit();
+      my->_workers.clear();
+      for( uint32_t i = 0; i < num_threads; ++i )
+         my->_workers.push_back( std::unique_ptr<fc::thread>( new fc::thread( "json_connection_worker" ) ) );
+   }
+
    void json_connection::add_method( const fc::string& name, method m )
    {
       my->_methods.emplace(std::pair<std::string,method>(name,fc::move(m)));
@@ -283,19 +517,22 @@ namespace fc { namespace rpc {
    }
    void json_connection::notice( const fc::string& method, const variants& args )
    {
-      fc::scoped_lock<fc::mutex> lock(my->_write_mutex);
-      *my->_out << "{\"method\":";
-      json::to_stream( *my->_out, method );
-      if( args.size() )
-      {
-         *my->_out << ",\"params\":";
-         fc::json::to_stream( *my->_out, args );
-         *my->_out << "}\n";
-      }
-      else
       {
-         *my->_out << ",\"params\":[]}\n";
+        fc::scoped_lock<fc::mutex> lock(my->_write_mutex);
+        *my->_out << "{\"method\":";
+        json::to_stream( *my->_out, method );
+        if( args.size() )
+        {
+           *my->_out << ",\"params\":";
+           fc::json::to_stream( *my->_out, args );
+           *my->_out << "}\n";
+        }
+        else
+        {
+           *my->_out << ",\"params\":[]}\n";
+        }
       }
+      my->_out->flush();
    }
    void json_connection::notice( const fc::string& method, const variant_object& named_args )
    {
@@ -349,7 +586,6 @@ namespace fc { namespace rpc {
 
    future<variant> json_connection::async_call( const fc::string& method, const variant& a1 )
    {
-      ilog( "");
       auto id = my->_next_id++;
       my->_awaiting[id] = fc::promise<variant>::ptr( new fc::promise<variant>() );
 
@@ -368,7 +604,6 @@ namespace fc { namespace rpc {
    }
    future<variant> json_connection::async_call( const fc::string& method, const variant& a1, const variant& a2 )
    {
-      ilog( "");
       auto id = my->_next_id++;
       my->_awaiting[id] = fc::promise<variant>::ptr( new fc::promise<variant>() );
 
@@ -389,7 +624,6 @@ namespace fc { namespace rpc {
    }
    future<variant> json_connection::async_call( const fc::string& method, const variant& a1, const variant& a2, const variant& a3 )
    {
-      ilog( "");
       auto id = my->_next_id++;
       my->_awaiting[id] = fc::promise<variant>::ptr( new fc::promise<variant>() );
 
@@ -419,7 +653,7 @@ namespace fc { namespace rpc {
    }
    future<variant> json_connection::async_call( const fc::string& method, const variant_object& named_args )
    {
-      wlog( "${method}  ${args}", ("method",method)("args",named_args) );
+      fc_dlog( my->_logger, "${method}  ${args}", ("method",method)("args",named_args) );
       auto id = my->_next_id++;
       my->_awaiting[id] = fc::promise<variant>::ptr( new fc::promise<variant>() );
       fc::scoped_lock<fc::mutex> lock(my->_write_mutex);
@@ -0,0 +1,210 @@
+#include <fc/rpc/variant_stream.hpp>
+#include <fc/thread/future.hpp>
+#include <fc/thread/spin_yield_lock.hpp>
+#include <fc/thread/unique_lock.hpp>
+#include <fc/exception/exception.hpp>
+#include <boost/atomic.hpp>
+#include <boost/memory_order.hpp>
+#include <vector>
+
+namespace fc
+{
+   namespace detail
+   {
+      static const size_t cache_line_size = 64;
+
+      /**
+       *  Keeps each counter on its own cache line so that producers bumping
+       *  the claim sequence do not invalidate the consumer's read sequence.
+       */
+      struct padded_sequence
+      {
+         padded_sequence( int64_t v = 0 ):value(v){}
+
+         char                   pad0[cache_line_size];
+         boost::atomic<int64_t> value;
+         char                   pad1[cache_line_size - sizeof(boost::atomic<int64_t>)];
+      };
+
+      class variant_stream_impl
+      {
+         public:
+            variant_stream_impl( size_t s )
+            :_capacity(1),_cached_end(0),_consumer_waiting(0),_producers_waiting(0)
+            {
+               while( _capacity < int64_t(s) ) _capacity <<= 1;
+               _mask = _capacity - 1;
+               _slots.resize( _capacity );
+               _published.reset( new boost::atomic<int64_t>[_capacity] );
+               for( int64_t i = 0; i < _capacity; ++i )
+                  _published[i].store( -1, boost::memory_order_relaxed );
+            }
+
+            int64_t                                    _capacity;
+            int64_t                                    _mask;
+
+            /** next position to be handed out by claim() */
+            padded_sequence                            _claim;
+            /** every position before this has been consumed */
+            padded_sequence                            _read;
+            /** only touched by the consumer */
+            int64_t                                    _cached_end;
+
+            std::vector<variant>                       _slots;
+            /** holds the position last published into each slot */
+            std::unique_ptr<boost::atomic<int64_t>[]>  _published;
+
+            spin_yield_lock                            _waiters_lock;
+            fc::promise<void>::ptr                     _consumer_waiter;
+            std::vector<fc::promise<void>::ptr>        _producer_waiters;
+            boost::atomic<int>                         _consumer_waiting;
+            boost::atomic<int>                         _producers_waiting;
+
+            void notify_consumer()
+            {
+               fc::promise<void>::ptr waiter;
+               { synchronized( _waiters_lock )
+                  fc_swap( waiter, _consumer_waiter );
+               }
+               if( waiter ) waiter->set_value();
+            }
+
+            void notify_producers()
+            {
+               std::vector<fc::promise<void>::ptr> waiters;
+               { synchronized( _waiters_lock )
+                  std::swap( waiters, _producer_waiters );
+               }
+               for( auto itr = waiters.begin(); itr != waiters.end(); ++itr )
+                  (*itr)->set_value();
+            }
+
+            /** blocks the calling fiber until every position before @param pos has been consumed */
+            void wait_for_read( int64_t pos )
+            {
+               while( _read.value.load( boost::memory_order_acquire ) < pos )
+               {
+                  fc::promise<void>::ptr p( new fc::promise<void>("variant_stream::wait_free") );
+                  { synchronized( _waiters_lock )
+                     _producer_waiters.push_back( p );
+                  }
+                  ++_producers_waiting;
+                  boost::atomic_thread_fence( boost::memory_order_seq_cst );
+                  // a stale promise left in _producer_waiters is harmless, consume() will set it
+                  if( _read.value.load( boost::memory_order_acquire ) < pos )
+                  {
+                     try { p->wait(); } catch ( ... ) { --_producers_waiting; throw; }
+                  }
+                  --_producers_waiting;
+               }
+            }
+      };
+   }
+
+   variant_stream::variant_stream( size_t s )
+   :my( new detail::variant_stream_impl( s ) )
+   {
+   }
+
+   variant_stream::~variant_stream()
+   {
+   }
+
+   int64_t variant_stream::free()
+   {
+      int64_t used = my->_claim.value.load( boost::memory_order_relaxed )
+                   - my->_read.value.load( boost::memory_order_acquire );
+      return used < my->_capacity ? my->_capacity - used : 0;
+   }
+
+   int64_t variant_stream::claim( int64_t num )
+   {
+      FC_ASSERT( num > 0 && num <= my->_capacity, "cannot claim ${num} from a ring of ${cap}",
+                 ("num",num)("cap",my->_capacity) );
+      int64_t pos = my->_claim.value.fetch_add( num, boost::memory_order_relaxed );
+      my->wait_for_read( pos + num - my->_capacity );
+      return pos;
+   }
+
+   int64_t variant_stream::publish( int64_t pos, int64_t num )
+   {
+      for( int64_t i = pos; i < pos + num; ++i )
+         my->_published[ i & my->_mask ].store( i, boost::memory_order_release );
+
+      boost::atomic_thread_fence( boost::memory_order_seq_cst );
+      if( my->_consumer_waiting.load( boost::memory_order_relaxed ) )
+         my->notify_consumer();
+      return pos + num;
+   }
+
+   int64_t variant_stream::wait_free()
+   {
+      int64_t f;
+      while( (f = free()) <= 0 )
+         my->wait_for_read( my->_claim.value.load( boost::memory_order_relaxed ) - my->_capacity + 1 );
+      return f;
+   }
+
+   variant& variant_stream::get( int64_t pos )
+   {
+      return my->_slots[ pos & my->_mask ];
+   }
+
+   int64_t variant_stream::begin()
+   {
+      return my->_read.value.load( boost::memory_order_relaxed );
+   }
+
+   int64_t variant_stream::end()
+   {
+      int64_t e       = my->_cached_end;
+      int64_t claimed = my->_claim.value.load( boost::memory_order_acquire );
+      while( e < claimed && my->_published[ e & my->_mask ].load( boost::memory_order_acquire ) == e )
+         ++e;
+      my->_cached_end = e;
+      return e;
+   }
+
+   int64_t variant_stream::wait( const microseconds& timeout )
+   {
+      const time_point deadline = timeout == microseconds::maximum() ? time_point::maximum()
+                                                                      : time_point::now() + timeout;
+      int64_t e = end();
+      while( e == begin() )
+      {
+         fc::promise<void>::ptr p( new fc::promise<void>("variant_stream::wait") );
+         { synchronized( my->_waiters_lock )
+            my->_consumer_waiter = p;
+         }
+         ++my->_consumer_waiting;
+         boost::atomic_thread_fence( boost::memory_order_seq_cst );
+
+         e = end();
+         if( e == begin() )
+         {
+            try { p->wait_until( deadline ); }
+            catch ( const timeout_exception& ) { --my->_consumer_waiting; return end(); }
+            catch ( ... ) { --my->_consumer_waiting; throw; }
+            e = end();
+         }
+         --my->_consumer_waiting;
+      }
+      return e;
+   }
+
+   void variant_stream::consume( int64_t e )
+   {
+      int64_t b = begin();
+      FC_ASSERT( e >= b && e <= my->_cached_end, "cannot consume positions that have not been published" );
+
+      // release anything the variants refer to before handing the slots back
+      for( int64_t i = b; i < e; ++i )
+         my->_slots[ i & my->_mask ] = variant();
+
+      my->_read.value.store( e, boost::memory_order_release );
+      boost::atomic_thread_fence( boost::memory_order_seq_cst );
+      if( my->_producers_waiting.load( boost::memory_order_relaxed ) )
+         my->notify_producers();
+   }
+
+} // namespace fc
@@ -2,6 +2,7 @@
 #include <fc/thread/thread.hpp>
 #include <boost/context/all.hpp>
 #include <fc/exception/exception.hpp>
+#include <fc/log/log_scope.hpp>
 #include <vector>
 
 #include <boost/version.hpp>
@@ -195,6 +196,8 @@ namespace fc {
     bool                         canceled;
     bool                         complete;
     task_base*                   cur_task;
+    /** innermost log_scope of the fiber, see fc::log_scope */
+    log_scope_ptr                log_scope;
   };
 
 } // naemspace fc 
@@ -5,11 +5,12 @@
 #include <fc/fwd_impl.hpp>
 
 #include <fc/log/logger.hpp>
+#include <fc/log/log_scope.hpp>
 #include <boost/exception/all.hpp>
 
 namespace fc {
   task_base::task_base(void* func)
-  :_functor(func){
+  :_log_scope( log_scope::current() ),_functor(func){
   }
 
   void task_base::run() {
@@ -342,7 +342,9 @@ namespace fc {
                 if( next ) {
                     next->_set_active_context( current );
                     current->cur_task = next;
+                    current->log_scope = next->_log_scope;
                     next->run();
+                    current->log_scope.reset();
                     current->cur_task = 0;
                     next->_set_active_context(0);
                     next->release();
@@ -0,0 +1,36 @@
+#include <fc/thread/worker_pool.hpp>
+#include <boost/thread/thread.hpp>
+#include <algorithm>
+
+namespace fc {
+
+  worker_pool& worker_pool::instance()
+  {
+     static worker_pool pool;
+     return pool;
+  }
+
+  worker_pool::worker_pool()
+  {
+     uint32_t n = std::max<uint32_t>( boost::thread::hardware_concurrency(), 1 );
+     for( uint32_t i = 0; i < n; ++i )
+        _threads.push_back( new fc::thread( "worker" ) );
+  }
+
+  worker_pool::~worker_pool()
+  {
+     shutdown();
+  }
+
+  void worker_pool::shutdown()
+  {
+     std::vector<thread*> threads;
+     threads.swap( _threads );
+     for( auto itr = threads.begin(); itr != threads.end(); ++itr )
+     {
+        (*itr)->quit();
+        delete *itr;
+     }
+  }
+
+} // namespace fc
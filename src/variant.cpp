@@ -8,6 +8,8 @@
 //#include <fc/crypto/base64.hpp>
 #include <fc/crypto/hex.hpp>
 #include <boost/scoped_array.hpp>
+#include <algorithm>
+#include <mutex>
 
 namespace fc
 {
@@ -17,13 +19,15 @@ namespace fc
    void from_variant( const variant& var,  uint16_t& vo ){ vo = static_cast<uint16_t>(var.as_uint64()); }
 void to_variant( const std::vector<char>& var,  variant& vo )
 {
-  if( var.size() )
-      //vo = variant(base64_encode((unsigned char*)var.data(),var.size()));
-      vo = variant(to_hex(var.data(),var.size()));
-  else vo = "";
+  vo = variant( blob{ var } );
 }
 void from_variant( const variant& var,  std::vector<char>& vo )
 {
+     if( var.is_blob() )
+     {
+        vo = var.get_blob().data;
+        return;
+     }
      auto str = var.as_string();
      vo.resize( str.size() / 2 );
      if( vo.size() )
@@ -34,6 +38,47 @@ void from_variant( const variant& var,  std::vector<char>& vo )
 //   std::string b64 = base64_decode( var.as_string() );
 //   vo = std::vector<char>( b64.c_str(), b64.c_str() + b64.size() );
 }
+size_t from_variant( const variant& var,  char* data, size_t len )
+{
+   if( var.is_blob() )
+   {
+      const std::vector<char>& b = var.get_blob().data;
+      size_t n = std::min( b.size(), len );
+      if( n ) memcpy( data, b.data(), n );
+      return n;
+   }
+   auto str = var.as_string();
+   return from_hex( str.c_str(), str.size(), data, std::min( str.size() / 2, len ) );
+}
+namespace detail
+{
+   /**
+    *  The heap storage of a blob variant.  get_string() returns a reference,
+    *  so the hex form is built on first use and kept with the bytes.
+    */
+   struct blob_storage : public blob
+   {
+      blob_storage( blob b ):blob( fc::move(b) ){}
+      blob_storage( const blob_storage& b ):blob( b ){}
+
+      const string& hex()const
+      {
+         std::call_once( hex_once, [this]() {
+            if( data.size() ) hex_string = to_hex( data.data(), data.size() );
+         });
+         return hex_string;
+      }
+
+      mutable std::once_flag hex_once;
+      mutable string         hex_string;
+   };
+}
+
+void variant::visitor::handle( const blob& v )const
+{
+   handle( v.data.size() ? to_hex( v.data.data(), v.data.size() ) : string() );
+}
+
 /**
  *  The TypeID is stored in the 'last byte' of the variant.
  */
@@ -145,10 +190,17 @@ variant::variant( variants arr )
    set_variant_type(this,  array_type );
 }
 
+variant::variant( blob val )
+{
+   *reinterpret_cast<detail::blob_storage**>(this)  = new detail::blob_storage(fc::move(val));
+   set_variant_type(this,  blob_type );
+}
+
 
 typedef const variant_object* const_variant_object_ptr; 
 typedef const variants* const_variants_ptr; 
 typedef const string* const_string_ptr;
+typedef const detail::blob_storage* const_blob_ptr;
 
 void variant::clear()
 {
@@ -163,6 +215,9 @@ void variant::clear()
      case string_type:
         delete *reinterpret_cast<string**>(this);
         break;
+     case blob_type:
+        delete *reinterpret_cast<detail::blob_storage**>(this);
+        break;
      default:
         break;
    }
@@ -188,6 +243,11 @@ variant::variant( const variant& v )
              new string(**reinterpret_cast<const const_string_ptr*>(&v) );
           set_variant_type( this, string_type );
           return;
+       case blob_type:
+          *reinterpret_cast<detail::blob_storage**>(this)  = 
+             new detail::blob_storage(**reinterpret_cast<const const_blob_ptr*>(&v) );
+          set_variant_type( this, blob_type );
+          return;
        default:
           memcpy( this, &v, sizeof(v) );
    }
@@ -232,6 +292,9 @@ variant& variant::operator=( const variant& v )
       case string_type:
          *reinterpret_cast<string**>(this)  = new string((**reinterpret_cast<const const_string_ptr*>(&v)) );
          break;
+      case blob_type:
+         *reinterpret_cast<detail::blob_storage**>(this)  = new detail::blob_storage((**reinterpret_cast<const const_blob_ptr*>(&v)) );
+         break;
 
       default:
          memcpy( this, &v, sizeof(v) );
@@ -268,6 +331,9 @@ void  variant::visit( const visitor& v )const
       case object_type:
          v.handle( **reinterpret_cast<const const_variant_object_ptr*>(this) );
          return;
+      case blob_type:
+         v.handle( **reinterpret_cast<const const_blob_ptr*>(this) );
+         return;
       default:
          FC_THROW_EXCEPTION( assert_exception, "Invalid Type / Corrupted Memory" );
    }
@@ -329,6 +395,11 @@ bool variant::is_array()const
    return get_type() == array_type;
 }
 
+bool variant::is_blob()const
+{
+   return get_type() == blob_type;
+}
+
 int64_t variant::as_int64()const
 {
    switch( get_type() )
@@ -430,6 +501,8 @@ string    variant::as_string()const
           return *reinterpret_cast<const bool*>(this) ? "true" : "false";
       case null_type:
           return string();
+      case blob_type:
+          return (*reinterpret_cast<const const_blob_ptr*>(this))->hex();
       default:
       FC_THROW_EXCEPTION( bad_cast_exception, "Invalid cast from ${type} to string", ("type", int64_t(get_type()) ) );
    }
@@ -481,6 +554,8 @@ const string&        variant::get_string()const
 {
   if( get_type() == string_type )
      return **reinterpret_cast<const const_string_ptr*>(this);
+  if( get_type() == blob_type )
+     return (*reinterpret_cast<const const_blob_ptr*>(this))->hex();
   FC_THROW_EXCEPTION( bad_cast_exception, "Invalid cast from ${type} to Object" );
 }
 
@@ -493,6 +568,14 @@ const variant_object&  variant::get_object()const
   FC_THROW_EXCEPTION( bad_cast_exception, "Invalid cast from ${type} to Object" );
 }
 
+/// @throw if get_type() != blob_type
+const blob&  variant::get_blob()const
+{
+  if( get_type() == blob_type )
+     return **reinterpret_cast<const const_blob_ptr*>(this);
+  FC_THROW_EXCEPTION( bad_cast_exception, "Invalid cast from ${type} to Blob" );
+}
+
 void to_variant( const std::string& s, variant& v )
 {
     v = variant( fc::string(s) );
@@ -0,0 +1,130 @@
+#include <fc/crypto/aes.hpp>
+#include <fc/io/sstream.hpp>
+#include <fc/exception/exception.hpp>
+#include <iostream>
+
+/**
+ *  Round trips data through aes_ostream and aes_istream across the 64KB gcm
+ *  record boundary, and checks that truncated, reordered and tampered gcm
+ *  streams are rejected.
+ */
+namespace {
+
+  const size_t record_size = 64 * 1024;
+  const size_t tag_size    = 16;
+
+  std::string make_data( size_t size )
+  {
+     std::string d( size, '\0' );
+     uint64_t x = 0x9e3779b97f4a7c15ull ^ size;
+     for( size_t i = 0; i < size; ++i )
+     {
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        d[i] = char(x);
+     }
+     return d;
+  }
+
+  fc::sha256 make_key()
+  {
+     return fc::sha256::hash( "aes stream test", 15 );
+  }
+
+  const char iv[16] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
+
+  std::string encrypt( const std::string& plain, fc::aes_mode::type mode, size_t write_size )
+  {
+     auto sink = std::make_shared<fc::stringstream>();
+     fc::aes_ostream out( sink, make_key(), iv, mode );
+     for( size_t pos = 0; pos < plain.size(); pos += write_size )
+        out.write( plain.data() + pos, std::min( write_size, plain.size() - pos ) );
+     out.close();
+     return sink->str();
+  }
+
+  std::string decrypt( const std::string& cipher, fc::aes_mode::type mode )
+  {
+     fc::aes_istream in( std::make_shared<fc::stringstream>( cipher ), make_key(), iv, mode );
+     std::string out;
+     char buf[1000];
+     try {
+        for( ;; )
+        {
+           size_t n = in.readsome( buf, sizeof(buf) );
+           out.append( buf, n );
+        }
+     } catch ( const fc::eof_exception& ) {
+     }
+     return out;
+  }
+
+  bool check( const char* what, size_t size, bool ok )
+  {
+     if( !ok ) std::cerr<<what<<" of "<<size<<" bytes failed\n";
+     return ok;
+  }
+
+  template<typename Functor>
+  bool throws( Functor&& f )
+  {
+     try { f(); } catch ( const fc::eof_exception& ) { return false; } catch ( const fc::exception& ) { return true; }
+     return false;
+  }
+
+} // anonymous namespace
+
+int main()
+{
+  try {
+     bool ok = true;
+     size_t sizes[] = { 0, 1, 1000, record_size - 1, record_size, record_size + 1,
+                        2 * record_size, 3 * record_size + 12345 };
+     for( size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i )
+     {
+        size_t      size  = sizes[i];
+        std::string plain = make_data( size );
+
+        ok &= check( "cbc round trip", size, decrypt( encrypt( plain, fc::aes_mode::cbc, 777 ), fc::aes_mode::cbc ) == plain );
+
+        // written in pieces that straddle the record boundary and in one piece
+        std::string cipher = encrypt( plain, fc::aes_mode::gcm, 5000 );
+        ok &= check( "gcm round trip", size, decrypt( cipher, fc::aes_mode::gcm ) == plain );
+        ok &= check( "gcm single write", size, encrypt( plain, fc::aes_mode::gcm, size + 1 ) == cipher );
+
+        ok &= check( "truncated gcm stream", size,
+                     throws( [&](){ decrypt( cipher.substr( 0, cipher.size() - 1 ), fc::aes_mode::gcm ); } ) );
+
+        std::string tag = cipher;
+        tag[ tag.size() - 1 ] ^= 1;
+        ok &= check( "tampered gcm tag", size, throws( [&](){ decrypt( tag, fc::aes_mode::gcm ); } ) );
+
+        if( size > 0 )
+        {
+           std::string body = cipher;
+           body[ body.size() / 2 ] ^= 0x40;
+           ok &= check( "tampered gcm record", size, throws( [&](){ decrypt( body, fc::aes_mode::gcm ); } ) );
+        }
+
+        size_t sealed = record_size + tag_size;
+        if( cipher.size() > sealed )
+        {
+           // stopping after a complete record must not look like the end of the message
+           ok &= check( "gcm stream cut at a record", size,
+                        throws( [&](){ decrypt( cipher.substr( 0, sealed ), fc::aes_mode::gcm ); } ) );
+        }
+        if( cipher.size() >= 2 * sealed )
+        {
+           std::string swapped = cipher.substr( sealed, sealed ) + cipher.substr( 0, sealed ) + cipher.substr( 2 * sealed );
+           ok &= check( "reordered gcm records", size, throws( [&](){ decrypt( swapped, fc::aes_mode::gcm ); } ) );
+        }
+     }
+
+     std::cout<<(ok ? "aes stream: ok\n" : "aes stream: FAILED\n");
+     return ok ? 0 : 1;
+  }
+  catch ( fc::exception& e )
+  {
+     std::cerr<<e.to_detail_string()<<"\n";
+     return 1;
+  }
+}
@@ -0,0 +1,149 @@
+#include <fc/compress/lz4.hpp>
+#include <fc/io/sstream.hpp>
+#include <fc/exception/exception.hpp>
+#include <iostream>
+
+/**
+ *  Round trips data through the lz4 functions and streams, and feeds the
+ *  decompressor truncated, corrupt and random input, which must be rejected
+ *  or decode within the output buffer.
+ */
+namespace {
+
+  uint64_t next( uint64_t& x )
+  {
+     x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+     return x;
+  }
+
+  std::vector<char> make_data( size_t size, bool compressible )
+  {
+     std::vector<char> d( size );
+     uint64_t x = 0x9e3779b97f4a7c15ull ^ size;
+     for( size_t i = 0; i < size; ++i )
+        d[i] = compressible ? char( 'a' + (next( x ) % 4) ) : char( next( x ) );
+     return d;
+  }
+
+  std::string stream_compress( const std::vector<char>& data, size_t block_size )
+  {
+     auto sink = std::make_shared<fc::stringstream>();
+     {
+        fc::lz4_ostream out( sink, block_size );
+        for( size_t pos = 0; pos < data.size(); pos += 1000 )
+           out.write( data.data() + pos, std::min<size_t>( 1000, data.size() - pos ) );
+        out.close();
+     }
+     return sink->str();
+  }
+
+  std::vector<char> stream_decompress( const std::string& compressed )
+  {
+     fc::lz4_istream in( std::make_shared<fc::stringstream>( compressed ) );
+     std::vector<char> out;
+     char buf[1000];
+     try {
+        for( ;; )
+        {
+           size_t n = in.readsome( buf, sizeof(buf) );
+           out.insert( out.end(), buf, buf + n );
+        }
+     } catch ( const fc::eof_exception& ) {
+     }
+     return out;
+  }
+
+  bool check( const char* what, bool ok )
+  {
+     if( !ok ) std::cerr<<what<<" failed\n";
+     return ok;
+  }
+
+  template<typename Functor>
+  bool throws( Functor&& f )
+  {
+     try { f(); } catch ( const fc::exception& ) { return true; }
+     return false;
+  }
+
+  /** decompresses @param in into a buffer of exactly @param out_size bytes, @return false if rejected */
+  bool decompress_exact( const std::vector<char>& in, size_t out_size )
+  {
+     std::vector<char> out( out_size );
+     try {
+        size_t n = fc::lz4_decompress( in.data(), in.size(), out.data(), out.size() );
+        return n <= out_size;
+     } catch ( const fc::exception& ) {
+        return false;
+     }
+  }
+
+} // anonymous namespace
+
+int main()
+{
+  try {
+     bool ok = true;
+     size_t sizes[] = { 0, 1, 12, 13, 100, 65535, 65536, 65537, 1000003 };
+     for( size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i )
+     {
+        for( int compressible = 0; compressible < 2; ++compressible )
+        {
+           std::vector<char> data = make_data( sizes[i], compressible != 0 );
+
+           std::vector<char> block( fc::lz4_compress_bound( data.size() ) );
+           block.resize( fc::lz4_compress( data.data(), data.size(), block.data() ) );
+           std::vector<char> plain( data.size() );
+           ok &= check( "lz4 block round trip",
+                        fc::lz4_decompress( block.data(), block.size(), plain.data(), plain.size() ) == data.size() && plain == data );
+           if( data.size() )
+              ok &= check( "lz4 block into a short buffer", !decompress_exact( block, data.size() - 1 ) );
+
+           ok &= check( "lz4 vector round trip", fc::lz4_decompress( fc::lz4_compress( data ) ) == data );
+           if( data.size() > 1 )
+              ok &= check( "lz4 vector size limit", throws( [&](){ fc::lz4_decompress( fc::lz4_compress( data ), data.size() - 1 ); } ) );
+
+           std::string compressed = stream_compress( data, 4096 );
+           ok &= check( "lz4 stream round trip", stream_decompress( compressed ) == data );
+           ok &= check( "lz4 stream with large blocks", stream_decompress( stream_compress( data, 1024*1024 ) ) == data );
+
+           if( data.size() > 100 )
+           {
+              std::string truncated = compressed.substr( 0, compressed.size() / 2 );
+              ok &= check( "truncated lz4 stream", throws( [&](){ stream_decompress( truncated ); } ) );
+              std::string missing_end = compressed.substr( 0, compressed.size() - 8 );
+              ok &= check( "lz4 stream without end block", throws( [&](){ stream_decompress( missing_end ); } ) );
+
+              // lz4 has no checksum, so a flipped byte may decode to other data,
+              // but it must never decode past the buffer it was given
+              for( size_t pos = 0; pos < block.size(); pos += block.size() / 31 + 1 )
+              {
+                 std::vector<char> corrupt = block;
+                 corrupt[pos] ^= 0x55;
+                 decompress_exact( corrupt, data.size() );
+              }
+              for( size_t len = 0; len < block.size(); len += block.size() / 17 + 1 )
+                 ok &= check( "truncated lz4 block", !decompress_exact( std::vector<char>( block.begin(), block.begin() + len ), data.size() ) || len == 0 );
+           }
+        }
+     }
+
+     // random input must be rejected or stay inside the output buffer
+     uint64_t x = 12345;
+     for( int i = 0; i < 20000; ++i )
+     {
+        std::vector<char> garbage( next( x ) % 64 + 1 );
+        for( auto itr = garbage.begin(); itr != garbage.end(); ++itr )
+           *itr = char( next( x ) );
+        decompress_exact( garbage, size_t( next( x ) % 256 ) );
+     }
+
+     std::cout<<(ok ? "lz4: ok\n" : "lz4: FAILED\n");
+     return ok ? 0 : 1;
+  }
+  catch ( fc::exception& e )
+  {
+     std::cerr<<e.to_detail_string()<<"\n";
+     return 1;
+  }
+}
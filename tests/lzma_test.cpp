@@ -0,0 +1,122 @@
+#include <fc/compress/lzma.hpp>
+#include <fc/io/sstream.hpp>
+#include <fc/exception/exception.hpp>
+#include <iostream>
+
+/**
+ *  Round trips data through lzma_compress and lzma_ostream, and checks that
+ *  corrupt and truncated input is rejected.
+ */
+namespace {
+
+  std::vector<char> make_data( size_t size, bool compressible )
+  {
+     std::vector<char> d( size );
+     uint64_t x = 0x9e3779b97f4a7c15ull ^ size;
+     for( size_t i = 0; i < size; ++i )
+     {
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        d[i] = compressible ? char( 'a' + (x % 4) ) : char(x);
+     }
+     return d;
+  }
+
+  std::string stream_compress( const std::vector<char>& data, size_t block_size, size_t write_size )
+  {
+     auto sink = std::make_shared<fc::stringstream>();
+     {
+        fc::lzma_ostream out( sink, 5, block_size );
+        for( size_t pos = 0; pos < data.size(); pos += write_size )
+           out.write( data.data() + pos, std::min( write_size, data.size() - pos ) );
+        out.close();
+     }
+     return sink->str();
+  }
+
+  std::vector<char> stream_decompress( const std::string& compressed )
+  {
+     fc::lzma_istream in( std::make_shared<fc::stringstream>( compressed ) );
+     std::vector<char> out;
+     char buf[1000];
+     try {
+        for( ;; )
+        {
+           size_t n = in.readsome( buf, sizeof(buf) );
+           out.insert( out.end(), buf, buf + n );
+        }
+     } catch ( const fc::eof_exception& ) {
+     }
+     return out;
+  }
+
+  bool check( const char* what, bool ok )
+  {
+     if( !ok ) std::cerr<<what<<" failed\n";
+     return ok;
+  }
+
+  template<typename Functor>
+  bool throws( Functor&& f )
+  {
+     try { f(); } catch ( const fc::exception& ) { return true; }
+     return false;
+  }
+
+} // anonymous namespace
+
+int main()
+{
+  try {
+     bool ok = true;
+     size_t sizes[] = { 0, 1, 100, 65536, 1000003 };
+     for( size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i )
+     {
+        for( int compressible = 0; compressible < 2; ++compressible )
+        {
+           std::vector<char> data = make_data( sizes[i], compressible != 0 );
+           ok &= check( "lzma_compress round trip", fc::lzma_decompress( fc::lzma_compress( data ) ) == data );
+
+           // many small blocks compressed in parallel, written in uneven pieces
+           std::string compressed = stream_compress( data, 4096, 1000 );
+           ok &= check( "lzma_ostream round trip", stream_decompress( compressed ) == data );
+           ok &= check( "single block lzma_ostream round trip", stream_decompress( stream_compress( data, 4*1024*1024, 65536 ) ) == data );
+
+           if( data.size() > 100 )
+           {
+              std::string truncated = compressed.substr( 0, compressed.size() / 2 );
+              ok &= check( "truncated lzma stream", throws( [&](){ stream_decompress( truncated ); } ) );
+
+              std::string missing_end = compressed.substr( 0, compressed.size() - 8 );
+              ok &= check( "lzma stream without end block", throws( [&](){ stream_decompress( missing_end ); } ) );
+
+              // a flipped byte must never decode to different data; some header
+              // bytes, such as the dictionary size, can change without harm
+              size_t detected = 0;
+              for( size_t pos = 0; pos < compressed.size(); pos += compressed.size() / 23 + 1 )
+              {
+                 std::string corrupt = compressed;
+                 corrupt[pos] ^= 0x55;
+                 try {
+                    ok &= check( "corrupt lzma stream", stream_decompress( corrupt ) == data );
+                 } catch ( const fc::exception& ) {
+                    ++detected;
+                 }
+              }
+              ok &= check( "corrupt lzma stream detection", detected > 0 );
+
+              std::vector<char> member = fc::lzma_compress( data );
+              member[ member.size() - 20 ] ^= 0x55;
+              ok &= check( "corrupt lzip member", throws( [&](){ fc::lzma_decompress( member ); } ) );
+           }
+        }
+     }
+
+     std::cout<<(ok ? "lzma: ok\n" : "lzma: FAILED\n");
+     return ok ? 0 : 1;
+  }
+  catch ( fc::exception& e )
+  {
+     std::cerr<<e.to_detail_string()<<"\n";
+     return 1;
+  }
+}
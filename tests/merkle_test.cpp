@@ -0,0 +1,97 @@
+#include <fc/crypto/merkle.hpp>
+#include <fc/exception/exception.hpp>
+#include <iostream>
+
+/**
+ *  Compares fc::merkle against a naive pairwise tree, including trees large
+ *  enough for merkle::root to split its levels over the hash threads.
+ */
+namespace {
+
+  fc::sha256 naive_root( std::vector<fc::sha256> level )
+  {
+     if( level.empty() ) return fc::sha256();
+     while( level.size() > 1 )
+     {
+        std::vector<fc::sha256> above;
+        for( size_t i = 0; i < level.size(); i += 2 )
+           above.push_back( fc::merkle::hash_pair( level[i], i + 1 < level.size() ? level[i+1] : level[i] ) );
+        level.swap( above );
+     }
+     return level[0];
+  }
+
+  std::vector<fc::sha256> make_leaves( size_t count )
+  {
+     std::vector<fc::sha256> leaves( count );
+     for( uint64_t i = 0; i < count; ++i )
+        leaves[i] = fc::sha256::hash( (const char*)&i, sizeof(i) );
+     return leaves;
+  }
+
+  bool check( size_t count )
+  {
+     std::vector<fc::sha256> leaves = make_leaves( count );
+     fc::sha256 expected = naive_root( leaves );
+     bool ok = true;
+
+     // 0 uses every hash thread, 1 keeps the whole tree on this thread
+     uint32_t threads[] = { 0, 1, 2, 3 };
+     for( size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); ++t )
+     {
+        if( fc::merkle::root( leaves, threads[t] ) != expected )
+        {
+           std::cerr<<"root of "<<count<<" leaves with "<<threads[t]<<" threads differs\n";
+           ok = false;
+        }
+     }
+
+     fc::merkle::tree tree( leaves );
+     if( tree.root() != expected )
+     {
+        std::cerr<<"tree of "<<count<<" leaves differs\n";
+        ok = false;
+     }
+
+     fc::merkle::tree appended;
+     for( auto itr = leaves.begin(); itr != leaves.end(); ++itr )
+        appended.append( *itr );
+     if( appended.root() != expected )
+     {
+        std::cerr<<"appended tree of "<<count<<" leaves differs\n";
+        ok = false;
+     }
+
+     for( size_t i = 0; i < count; i += count / 7 + 1 )
+     {
+        fc::merkle::proof p = tree.make_proof( i );
+        if( !p.verify( leaves[i], expected ) || (count > 1 && p.verify( leaves[(i+1) % count], expected )) )
+        {
+           std::cerr<<"proof of leaf "<<i<<" of "<<count<<" is wrong\n";
+           ok = false;
+        }
+     }
+     return ok;
+  }
+
+} // anonymous namespace
+
+int main()
+{
+  try {
+     // levels with more than 4096 parents are hashed in parallel, the larger
+     // sizes split into several chunks and end on an odd node
+     size_t sizes[] = { 0, 1, 2, 3, 5, 8, 13, 100, 8191, 8192, 8193, 8194, 16385, 40001, 100003 };
+     bool ok = true;
+     for( size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i )
+        ok = check( sizes[i] ) && ok;
+
+     std::cout<<(ok ? "merkle: ok\n" : "merkle: FAILED\n");
+     return ok ? 0 : 1;
+  }
+  catch ( fc::exception& e )
+  {
+     std::cerr<<e.to_detail_string()<<"\n";
+     return 1;
+  }
+}
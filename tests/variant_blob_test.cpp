@@ -0,0 +1,90 @@
+#include <fc/variant.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/io/raw_variant.hpp>
+#include <fc/io/json.hpp>
+#include <fc/crypto/sha256.hpp>
+#include <fc/crypto/hex.hpp>
+#include <fc/exception/exception.hpp>
+#include <iostream>
+
+/**
+ *  Checks that byte vectors and hashes survive the trip through a blob
+ *  variant, fc::raw and json, and that hex strings packed with the string
+ *  tag by older writers are still read.
+ */
+namespace {
+
+  bool check( const char* what, bool ok )
+  {
+     if( !ok ) std::cerr<<what<<" failed\n";
+     return ok;
+  }
+
+  std::vector<char> pack_variant( const fc::variant& v )
+  {
+     return fc::raw::pack( v );
+  }
+
+  fc::variant unpack_variant( const std::vector<char>& d )
+  {
+     return fc::raw::unpack<fc::variant>( d );
+  }
+
+  bool check_bytes( const std::vector<char>& bytes )
+  {
+     bool ok = true;
+     std::string hex = bytes.size() ? fc::to_hex( bytes.data(), bytes.size() ) : std::string();
+
+     fc::variant v;
+     fc::to_variant( bytes, v );
+     ok &= check( "vector to blob variant", v.is_blob() && v.get_blob().data == bytes );
+     ok &= check( "blob as_string", v.as_string() == hex );
+     ok &= check( "blob variant to vector", v.as<std::vector<char>>() == bytes );
+
+     fc::variant copy( v );
+     ok &= check( "copied blob", copy.is_blob() && copy.as<std::vector<char>>() == bytes );
+
+     fc::variant raw = unpack_variant( pack_variant( v ) );
+     ok &= check( "blob raw round trip", raw.is_blob() && raw.get_blob().data == bytes );
+
+     std::string json = fc::json::to_string( v );
+     ok &= check( "blob to json", json == "\"" + hex + "\"" );
+     fc::variant parsed = fc::json::from_string( json );
+     ok &= check( "blob json round trip", parsed.as<std::vector<char>>() == bytes );
+
+     // writers without blob_type packed the hex string with the string tag
+     fc::variant old = unpack_variant( pack_variant( fc::variant( hex ) ) );
+     ok &= check( "tag 5 hex input", old.as<std::vector<char>>() == bytes );
+     return ok;
+  }
+
+} // anonymous namespace
+
+int main()
+{
+  try {
+     bool ok = true;
+     ok &= check_bytes( std::vector<char>() );
+     ok &= check_bytes( std::vector<char>( 1, char(0xab) ) );
+
+     std::vector<char> bytes( 1000 );
+     for( size_t i = 0; i < bytes.size(); ++i ) bytes[i] = char( i * 7 + 3 );
+     ok &= check_bytes( bytes );
+
+     fc::sha256 h = fc::sha256::hash( "blob", 4 );
+     fc::variant hv( h );
+     ok &= check( "sha256 to blob variant", hv.is_blob() && hv.as<fc::sha256>() == h );
+     ok &= check( "sha256 packed size", pack_variant( hv ).size() == 2 + sizeof(h) );
+     ok &= check( "sha256 raw round trip", unpack_variant( pack_variant( hv ) ).as<fc::sha256>() == h );
+     ok &= check( "sha256 json round trip", fc::json::from_string( fc::json::to_string( hv ) ).as<fc::sha256>() == h );
+     ok &= check( "sha256 from tag 5 hex", unpack_variant( pack_variant( fc::variant( h.str() ) ) ).as<fc::sha256>() == h );
+
+     std::cout<<(ok ? "variant blob: ok\n" : "variant blob: FAILED\n");
+     return ok ? 0 : 1;
+  }
+  catch ( fc::exception& e )
+  {
+     std::cerr<<e.to_detail_string()<<"\n";
+     return 1;
+  }
+}
@@ -0,0 +1,419 @@
+#include <fc/crypto/sha1.hpp>
+#include <fc/crypto/sha224.hpp>
+#include <fc/crypto/sha256.hpp>
+#include <fc/crypto/sha512.hpp>
+#include <fc/crypto/ripemd160.hpp>
+#include <fc/crypto/city.hpp>
+#include <fc/crypto/crc.hpp>
+#include <fc/crypto/aes.hpp>
+#include <fc/crypto/blowfish.hpp>
+#include <fc/crypto/base58.hpp>
+#include <fc/crypto/base64.hpp>
+#include <fc/crypto/hex.hpp>
+#include <fc/crypto/elliptic.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/exception/exception.hpp>
+#include <fc/variant_object.hpp>
+#include <fc/io/json.hpp>
+#include <fc/time.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <functional>
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+
+uint32_t crc32cSlicingBy8(uint32_t crc, const void* data, size_t length);
+
+/**
+ *  Measures the throughput of the fc::crypto primitives.
+ *
+ *  usage: fc_crypto_bench [--json] [--seconds=S] [--sizes=N,...] [--threads=N,...] [filter...]
+ *
+ *  Every benchmark whose name contains one of the filters is run for each
+ *  message size and thread count.  With --threads=T, T threads run the
+ *  benchmark at once and the rates are summed.  --json prints one object per
+ *  line instead of a table.
+ */
+namespace {
+
+  /** one operation of a benchmark, @return a value that depends on the output */
+  typedef std::function<uint64_t()> operation;
+
+  struct benchmark
+  {
+     const char* name;
+     /** false if the operation does not depend on the message size */
+     bool        sized;
+     /** sizes above this are skipped, for the algorithms that are not linear */
+     size_t      max_size;
+     /** the number of messages every operation handles */
+     size_t      batch;
+     /** builds the operation for a message of @param size bytes, called once per thread */
+     std::function<operation( size_t size )> setup;
+  };
+
+  std::vector<char> random_bytes( size_t size )
+  {
+     std::vector<char> d( size );
+     uint64_t x = 0x9e3779b97f4a7c15ull ^ size;
+     for( size_t i = 0; i < size; ++i )
+     {
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        d[i] = char(x);
+     }
+     return d;
+  }
+
+  template<typename H>
+  benchmark hash_benchmark( const char* name )
+  {
+     return benchmark{ name, true, size_t(-1), 1, []( size_t size ) -> operation {
+        auto d = std::make_shared< std::vector<char> >( random_bytes( size ) );
+        return [=]() { return uint64_t( (uint8_t)H::hash( d->data(), uint32_t(d->size()) ).data()[0] ); };
+     } };
+  }
+
+  operation aes_encode_op( size_t size, fc::aes_mode::type mode )
+  {
+     auto enc   = std::make_shared<fc::aes_encoder>();
+     auto plain = std::make_shared< std::vector<char> >( random_bytes( size ) );
+     auto out   = std::make_shared< std::vector<char> >( size + 32 );
+     char iv[16] = {0};
+     enc->init( fc::sha256::hash( "key", 3 ), iv, mode );
+     return [=]() {
+        char iv[16] = {0};
+        enc->reset( iv );
+        size_t n = enc->encode( plain->data(), plain->size(), out->data() );
+        n += enc->final_encode( out->data() + n );
+        return uint64_t( n );
+     };
+  }
+
+  operation aes_decode_op( size_t size, fc::aes_mode::type mode )
+  {
+     fc::sha256 key = fc::sha256::hash( "key", 3 );
+     char iv[16] = {0};
+
+     fc::aes_encoder enc;
+     enc.init( key, iv, mode );
+     std::vector<char> plain = random_bytes( size );
+     auto cipher = std::make_shared< std::vector<char> >( size + 32 );
+     size_t n = enc.encode( plain.data(), plain.size(), cipher->data() );
+     n += enc.final_encode( cipher->data() + n );
+     cipher->resize( n );
+     fc::aes_tag tag = enc.tag();
+
+     auto dec = std::make_shared<fc::aes_decoder>();
+     auto out = std::make_shared< std::vector<char> >( size + 32 );
+     dec->init( key, iv, mode );
+     return [=]() {
+        char iv[16] = {0};
+        dec->reset( iv );
+        size_t n = dec->decode( cipher->data(), cipher->size(), out->data() );
+        if( mode == fc::aes_mode::gcm ) dec->set_tag( tag );
+        n += dec->final_decode( out->data() + n );
+        return uint64_t( n );
+     };
+  }
+
+  operation blowfish_op( size_t size, bool encrypt )
+  {
+     auto bf  = std::make_shared<fc::blowfish>();
+     auto in  = std::make_shared< std::vector<char> >( random_bytes( size & ~size_t(7) ) );
+     auto out = std::make_shared< std::vector<char> >( in->size() );
+     unsigned char key[16] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
+     bf->start( key, sizeof(key) );
+     return [=]() {
+        bf->reset_chain();
+        if( encrypt ) bf->encrypt( (const unsigned char*)in->data(), (unsigned char*)out->data(), in->size() );
+        else          bf->decrypt( (const unsigned char*)in->data(), (unsigned char*)out->data(), in->size() );
+        return uint64_t( out->size() ? (uint8_t)(*out)[0] : 0 );
+     };
+  }
+
+  /** the signatures of ecc_batch different messages by as many keys */
+  struct ecc_fixture
+  {
+     ecc_fixture( size_t n )
+     {
+        for( size_t i = 0; i < n; ++i )
+        {
+           fc::ecc::private_key k = fc::ecc::private_key::generate();
+           fc::sha256 d = fc::sha256::hash( (const char*)&i, sizeof(i) );
+           keys.push_back( k );
+           pubs.push_back( k.get_public_key() );
+           digests.push_back( d );
+           sigs.push_back( k.sign( d ) );
+           compact.push_back( k.sign_compact( d ) );
+        }
+     }
+     std::vector<fc::ecc::private_key>     keys;
+     std::vector<fc::ecc::public_key>      pubs;
+     std::vector<fc::sha256>               digests;
+     std::vector<fc::ecc::signature>       sigs;
+     std::vector<fc::ecc::compact_signature> compact;
+  };
+
+  static const size_t ecc_batch = 64;
+
+  std::vector<benchmark> all_benchmarks()
+  {
+     std::vector<benchmark> b;
+     b.push_back( hash_benchmark<fc::sha1>( "sha1" ) );
+     b.push_back( hash_benchmark<fc::sha224>( "sha224" ) );
+     b.push_back( hash_benchmark<fc::sha256>( "sha256" ) );
+     b.push_back( hash_benchmark<fc::sha512>( "sha512" ) );
+     b.push_back( hash_benchmark<fc::ripemd160>( "ripemd160" ) );
+
+     b.push_back( benchmark{ "sha256_hash_many", true, size_t(-1), 16, []( size_t size ) -> operation {
+        auto d   = std::make_shared< std::vector<char> >( random_bytes( size * 16 ) );
+        auto out = std::make_shared< std::vector<fc::sha256> >( 16 );
+        return [=]() {
+           const char* data[16];
+           uint32_t    sizes[16];
+           for( size_t i = 0; i < 16; ++i ) { data[i] = d->data() + i * size; sizes[i] = uint32_t(size); }
+           fc::sha256::hash_many( data, sizes, out->data(), 16 );
+           return uint64_t( (uint8_t)(*out)[15].data()[0] );
+        };
+     } } );
+
+     b.push_back( benchmark{ "city_hash64", true, size_t(-1), 1, []( size_t size ) -> operation {
+        auto d = std::make_shared< std::vector<char> >( random_bytes( size ) );
+        return [=]() { return fc::city_hash64( d->data(), d->size() ); };
+     } } );
+     b.push_back( benchmark{ "city_hash128", true, size_t(-1), 1, []( size_t size ) -> operation {
+        auto d = std::make_shared< std::vector<char> >( random_bytes( size ) );
+        return [=]() { return fc::city_hash128( d->data(), d->size() ).low_bits(); };
+     } } );
+     b.push_back( benchmark{ "city_hash_crc_64", true, size_t(-1), 1, []( size_t size ) -> operation {
+        auto d = std::make_shared< std::vector<char> >( random_bytes( size ) );
+        return [=]() { return fc::city_hash_crc_64( d->data(), d->size() ); };
+     } } );
+     b.push_back( benchmark{ "city_hash_crc_128", true, size_t(-1), 1, []( size_t size ) -> operation {
+        auto d = std::make_shared< std::vector<char> >( random_bytes( size ) );
+        return [=]() { return fc::city_hash_crc_128( d->data(), d->size() ).low_bits(); };
+     } } );
+
+     b.push_back( benchmark{ "crc32c", true, size_t(-1), 1, []( size_t size ) -> operation {
+        auto d = std::make_shared< std::vector<char> >( random_bytes( size ) );
+        return [=]() { return uint64_t( fc::crc32c( d->data(), d->size() ) ); };
+     } } );
+     b.push_back( benchmark{ "crc32cSlicingBy8", true, size_t(-1), 1, []( size_t size ) -> operation {
+        auto d = std::make_shared< std::vector<char> >( random_bytes( size ) );
+        return [=]() { return uint64_t( crc32cSlicingBy8( 0, d->data(), d->size() ) ); };
+     } } );
+
+     b.push_back( benchmark{ "aes_cbc_encrypt", true, size_t(-1), 1, []( size_t size ) { return aes_encode_op( size, fc::aes_mode::cbc ); } } );
+     b.push_back( benchmark{ "aes_cbc_decrypt", true, size_t(-1), 1, []( size_t size ) { return aes_decode_op( size, fc::aes_mode::cbc ); } } );
+     b.push_back( benchmark{ "aes_gcm_encrypt", true, size_t(-1), 1, []( size_t size ) { return aes_encode_op( size, fc::aes_mode::gcm ); } } );
+     b.push_back( benchmark{ "aes_gcm_decrypt", true, size_t(-1), 1, []( size_t size ) { return aes_decode_op( size, fc::aes_mode::gcm ); } } );
+     b.push_back( benchmark{ "blowfish_encrypt", true, size_t(-1), 1, []( size_t size ) { return blowfish_op( size, true ); } } );
+     b.push_back( benchmark{ "blowfish_decrypt", true, size_t(-1), 1, []( size_t size ) { return blowfish_op( size, false ); } } );
+
+     b.push_back( benchmark{ "to_hex", true, size_t(-1), 1, []( size_t size ) -> operation {
+        auto d = std::make_shared< std::vector<char> >( random_bytes( size ) );
+        return [=]() { return uint64_t( fc::to_hex( d->data(), uint32_t(d->size()) ).size() ); };
+     } } );
+     b.push_back( benchmark{ "from_hex", true, size_t(-1), 1, []( size_t size ) -> operation {
+        std::vector<char> d = random_bytes( size );
+        auto hex = std::make_shared<fc::string>( fc::to_hex( d.data(), uint32_t(d.size()) ) );
+        auto out = std::make_shared< std::vector<char> >( size );
+        return [=]() { return uint64_t( fc::from_hex( *hex, out->data(), out->size() ) ); };
+     } } );
+     b.push_back( benchmark{ "to_base64", true, size_t(-1), 1, []( size_t size ) -> operation {
+        auto d = std::make_shared< std::vector<char> >( random_bytes( size ) );
+        return [=]() { return uint64_t( fc::base64_encode( (const unsigned char*)d->data(), (unsigned int)d->size() ).size() ); };
+     } } );
+     b.push_back( benchmark{ "from_base64", true, size_t(-1), 1, []( size_t size ) -> operation {
+        std::vector<char> d = random_bytes( size );
+        auto b64 = std::make_shared<std::string>( fc::base64_encode( (const unsigned char*)d.data(), (unsigned int)d.size() ) );
+        return [=]() { return uint64_t( fc::base64_decode( *b64 ).size() ); };
+     } } );
+     // base58 is quadratic in the message size
+     b.push_back( benchmark{ "to_base58", true, 4096, 1, []( size_t size ) -> operation {
+        auto d = std::make_shared< std::vector<char> >( random_bytes( size ) );
+        return [=]() { return uint64_t( fc::to_base58( d->data(), d->size() ).size() ); };
+     } } );
+     b.push_back( benchmark{ "from_base58", true, 4096, 1, []( size_t size ) -> operation {
+        std::vector<char> d = random_bytes( size );
+        auto b58 = std::make_shared<std::string>( fc::to_base58( d.data(), d.size() ) );
+        return [=]() { return uint64_t( fc::from_base58( *b58 ).size() ); };
+     } } );
+
+     b.push_back( benchmark{ "ecc_sign", false, 0, 1, []( size_t ) -> operation {
+        auto f = std::make_shared<ecc_fixture>( 1 );
+        return [=]() { return uint64_t( f->keys[0].sign( f->digests[0] ).data[0] ); };
+     } } );
+     b.push_back( benchmark{ "ecc_sign_compact", false, 0, 1, []( size_t ) -> operation {
+        auto f = std::make_shared<ecc_fixture>( 1 );
+        return [=]() { return uint64_t( f->keys[0].sign_compact( f->digests[0] ).data[0] ); };
+     } } );
+     b.push_back( benchmark{ "ecc_verify", false, 0, 1, []( size_t ) -> operation {
+        auto f = std::make_shared<ecc_fixture>( 1 );
+        return [=]() { return uint64_t( f->pubs[0].verify( f->digests[0], f->sigs[0] ) ); };
+     } } );
+     b.push_back( benchmark{ "ecc_recover", false, 0, 1, []( size_t ) -> operation {
+        auto f = std::make_shared<ecc_fixture>( 1 );
+        return [=]() { return uint64_t( fc::ecc::public_key( f->compact[0], f->digests[0] ).valid() ); };
+     } } );
+     // the harness provides the threads, the batches run on the calling thread
+     b.push_back( benchmark{ "ecc_verify_batch", false, 0, ecc_batch, []( size_t ) -> operation {
+        auto f = std::make_shared<ecc_fixture>( ecc_batch );
+        return [=]() {
+           return uint64_t( fc::ecc::verify_batch( f->digests.data(), f->sigs.data(), f->pubs.data(), ecc_batch, 1 ).back() );
+        };
+     } } );
+     b.push_back( benchmark{ "ecc_recover_batch", false, 0, ecc_batch, []( size_t ) -> operation {
+        auto f = std::make_shared<ecc_fixture>( ecc_batch );
+        return [=]() {
+           return uint64_t( fc::ecc::recover_batch( f->digests.data(), f->compact.data(), ecc_batch, 1 ).back().valid() );
+        };
+     } } );
+     return b;
+  }
+
+  struct result
+  {
+     uint64_t ops;
+     int64_t  usec;
+     uint64_t sink;
+  };
+
+  /** runs @param op until @param seconds have passed */
+  result run( const operation& op, double seconds )
+  {
+     result r = { 0, 0, op() };
+     int64_t limit = int64_t( seconds * 1000000 );
+     fc::time_point start = fc::time_point::now();
+     uint32_t step = 1;
+     do
+     {
+        for( uint32_t i = 0; i < step; ++i )
+           r.sink ^= op();
+        r.ops += step;
+        r.usec = (fc::time_point::now() - start).count();
+        // read the clock about every millisecond
+        if( r.usec < 1000 && step < (1u << 20) ) step *= 2;
+     } while( r.usec < limit );
+     return r;
+  }
+
+  std::vector<size_t> parse_list( const std::string& s )
+  {
+     std::vector<size_t> v;
+     size_t pos = 0;
+     while( pos < s.size() )
+     {
+        size_t end = s.find( ',', pos );
+        if( end == std::string::npos ) end = s.size();
+        v.push_back( size_t( strtoull( s.substr( pos, end - pos ).c_str(), nullptr, 10 ) ) );
+        pos = end + 1;
+     }
+     return v;
+  }
+
+} // anonymous namespace
+
+int main( int argc, char** argv )
+{
+  bool                     as_json = false;
+  double                   seconds = 0.5;
+  std::vector<size_t>      sizes   = { 64, 1024, 16384, 1048576 };
+  std::vector<size_t>      threads = { 1 };
+  std::vector<std::string> filters;
+
+  uint32_t cores = std::max<uint32_t>( boost::thread::hardware_concurrency(), 1 );
+  if( cores > 1 ) threads.push_back( cores );
+
+  for( int i = 1; i < argc; ++i )
+  {
+     std::string arg = argv[i];
+     if( arg == "--json" )                          as_json = true;
+     else if( arg.compare( 0, 10, "--seconds=" ) == 0 ) seconds = atof( arg.c_str() + 10 );
+     else if( arg.compare( 0, 8, "--sizes=" ) == 0 )    sizes   = parse_list( arg.substr( 8 ) );
+     else if( arg.compare( 0, 10, "--threads=" ) == 0 ) threads = parse_list( arg.substr( 10 ) );
+     else if( arg.compare( 0, 2, "--" ) == 0 )
+     {
+        std::cerr<<"usage: "<<argv[0]<<" [--json] [--seconds=S] [--sizes=N,...] [--threads=N,...] [filter...]\n";
+        return 1;
+     }
+     else filters.push_back( arg );
+  }
+
+  try {
+     size_t max_threads = 0;
+     for( auto itr = threads.begin(); itr != threads.end(); ++itr )
+        max_threads = std::max( max_threads, *itr );
+     std::vector<fc::thread*> pool;
+     for( size_t i = 0; i < max_threads; ++i )
+        pool.push_back( new fc::thread( "bench" ) );
+
+     if( !as_json )
+        printf( "%-20s %10s %8s %16s %14s\n", "benchmark", "size", "threads", "ops/sec", "MB/sec" );
+
+     uint64_t sink = 0;
+     auto benchmarks = all_benchmarks();
+     for( auto b = benchmarks.begin(); b != benchmarks.end(); ++b )
+     {
+        bool selected = filters.empty();
+        for( auto f = filters.begin(); f != filters.end(); ++f )
+           selected |= std::string( b->name ).find( *f ) != std::string::npos;
+        if( !selected ) continue;
+
+        std::vector<size_t> run_sizes = b->sized ? sizes : std::vector<size_t>( 1, 0 );
+        for( auto size = run_sizes.begin(); size != run_sizes.end(); ++size )
+        {
+           if( b->sized && *size > b->max_size ) continue;
+           for( auto t = threads.begin(); t != threads.end(); ++t )
+           {
+              if( *t == 0 ) continue;
+              std::vector< fc::future<result> > running;
+              for( size_t i = 0; i < *t; ++i )
+              {
+                 const benchmark& bench = *b;
+                 size_t           s     = *size;
+                 running.push_back( pool[i]->async( [&bench,s,seconds]() { return run( bench.setup( s ), seconds ); }, "fc_crypto_bench" ) );
+              }
+
+              double ops_per_sec = 0;
+              for( auto r = running.begin(); r != running.end(); ++r )
+              {
+                 result res = r->wait();
+                 ops_per_sec += double(res.ops) * b->batch * 1000000.0 / double(std::max<int64_t>( res.usec, 1 ));
+                 sink ^= res.sink;
+              }
+              double bytes_per_sec = ops_per_sec * double(*size);
+
+              if( as_json )
+              {
+                 fc::mutable_variant_object o;
+                 o( "benchmark", b->name )
+                  ( "size", uint64_t(*size) )
+                  ( "threads", uint64_t(*t) )
+                  ( "ops_per_sec", ops_per_sec );
+                 if( b->sized ) o( "bytes_per_sec", bytes_per_sec );
+                 std::cout<<fc::json::to_string( fc::variant( o ) )<<"\n";
+              }
+              else if( b->sized )
+                 printf( "%-20s %10llu %8llu %16.1f %14.2f\n", b->name, (unsigned long long)*size,
+                         (unsigned long long)*t, ops_per_sec, bytes_per_sec / (1024*1024) );
+              else
+                 printf( "%-20s %10s %8llu %16.1f %14s\n", b->name, "-", (unsigned long long)*t, ops_per_sec, "-" );
+              fflush( stdout );
+           }
+        }
+     }
+
+     for( auto itr = pool.begin(); itr != pool.end(); ++itr )
+        (*itr)->quit();
+     // keeps the results from being optimized away
+     if( sink == 0x5a5a5a5a5a5a5a5aull ) std::cerr<<"\n";
+  }
+  catch ( fc::exception& e )
+  {
+     std::cerr<<e.to_detail_string()<<"\n";
+     return 1;
+  }
+  return 0;
+}
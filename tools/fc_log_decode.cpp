@@ -0,0 +1,41 @@
+#include <iostream>
+#include <fc/log/binary_appender.hpp>
+#include <fc/exception/exception.hpp>
+#include <fc/io/json.hpp>
+
+/**
+ *  Prints the messages written by a binary_appender, oldest first.
+ *
+ *  usage: fc_log_decode <filename> [--json]
+ */
+int main( int argc, char** argv )
+{
+  if( argc < 2 )
+  {
+     std::cerr<<"usage: "<<argv[0]<<" <filename> [--json]\n";
+     return 1;
+  }
+  bool as_json = argc > 2 && std::string(argv[2]) == "--json";
+
+  try {
+     auto msgs = fc::read_binary_log( fc::path( argv[1] ) );
+     for( auto itr = msgs.begin(); itr != msgs.end(); ++itr )
+     {
+        if( as_json )
+        {
+           std::cout<<fc::json::to_string( *itr )<<"\n";
+           continue;
+        }
+        auto ctx = itr->get_context();
+        std::cout<<std::string(ctx.get_timestamp())<<" "<<ctx.get_thread_name()<<" "
+                 <<ctx.get_file()<<":"<<ctx.get_line_number()<<" "<<ctx.get_method()<<"] "
+                 <<itr->get_message()<<"\n";
+     }
+  } 
+  catch ( fc::exception& e ) 
+  {
+     std::cerr<<e.to_detail_string()<<"\n";
+     return 1;
+  }
+  return 0;
+}